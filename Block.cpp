@@ -1,12 +1,8 @@
 #include "Block.h"
-#include "openssl/sha.h"
-#include "iomanip"
 #include <string>
-#include <sstream>
 #include <string_view>
 #include "Logger.h"
-#include <thread>
-#include <atomic>
+#include "MiningKernel.h"
 #include <vector>
 #include "Transaction.h"
 
@@ -17,11 +13,12 @@ using std::endl;
 
 void Block::addTransaction(Transaction transaction)
 {
-    transactions.push_back(std::move(transaction));
     Logger::getInstance().log("Added transaction: " + transaction.toString());
+    transactions->push_back(std::move(transaction));
+    merkleRootCached = false;
 }
 
-    Genesis::Genesis(int index,long long timestamp,std::vector<Transaction>transactions,string prevHash,int nonce)
+    Genesis::Genesis(int index,long long timestamp,std::vector<Transaction>transactions,const Hash256& prevHash,uint64_t nonce)
         :Block(index,timestamp,transactions,prevHash,nonce)
     {
         Logger::getInstance().log("Create Genesis block with index=0");
@@ -30,136 +27,57 @@ void Block::addTransaction(Transaction transaction)
 
    Genesis& Genesis::getInstance()
     {
-       static Genesis instance(index,timestamp,std::vector<Transaction>{},string(prevHash),0);
+       static Genesis instance(index,timestamp,std::vector<Transaction>{},Hash256(),0); // prevHash Genesis - нулевой хэш
         return instance;
     }
     const int Genesis:: index=0;
     const long long Genesis:: timestamp = 21062025;
 
-    string Genesis::calculateHash() const
+    Hash256 Genesis::calculateHash() const
     {
-        std::string transactionsStr;
-        for(auto it= transactions.begin();it!=transactions.end();it++)
-        {
-            std::string currentTransactionString = it->toString();
-            if (!transactionsStr.empty())
-            {
-                transactionsStr += ";";
-            }
-            transactionsStr += currentTransactionString;
-        }
-
-
-
-        std::stringstream ss;
-        ss << index << ":" << timestamp << ":" << transactionsStr << ":" << prevHash << ":" << nonce;
-        string blockData=ss.str();
-        unsigned char hash[SHA256_DIGEST_LENGTH];
-        SHA256_CTX sha256;
-        SHA256_Init(&sha256);
-        SHA256_Update(&sha256,blockData.c_str(),blockData.length());
-        SHA256_Final(hash,&sha256);
-        std::stringstream ss_hex;
-        for(int i=0;i<SHA256_DIGEST_LENGTH;i++)
-        {
-            ss_hex<<std::hex<<std::setw(2)<<std::setfill('0')<<(int)hash[i];
-        }
-        return ss_hex.str();
-
+        return Hash256(getHeader().hash());
      }
-    void Genesis::mineBlock(int difficulty)
+    void Genesis::mineBlock(uint32_t bits)
     {
-        std::string target(difficulty, '0');
-        if (difficulty < 0)
-        {
-        throw std::invalid_argument("Difficulty must be positive!");
-        }
-
-        Logger::getInstance().log("Started mining Genesis block with difficulty= " + std::to_string(difficulty));
-        while(true)
-        {
-        string currentHash=calculateHash();
-            if(currentHash.substr(0,difficulty)==target)
-        {
-            hash= currentHash;
-                break;
-            }
-            this->nonce++;
-        }
-        Logger::getInstance().log("Mined Genesis block: nonce=" + std::to_string(this->nonce) + " ,hash= "+hash);
+        checkBits(bits);
+        Logger::getInstance().log("Started mining Genesis block with bits= " + BlockHeader::compactToString(bits));
+        mineOnPool(bits, 1, CancellationToken());
+        Logger::getInstance().log("Mined Genesis block: nonce=" + std::to_string(this->nonce) + " ,hash= "+hash.toHex());
 
     }
 
     const std::vector<Transaction>& Genesis::getTransactions() const
     {
-        return transactions;
+        return *transactions;
     }
 
 
 
-    void Genesis::mineBlockParallel(int difficulty, int numThreads)
+    bool Genesis::mineBlockParallel(uint32_t bits, int numThreads, const CancellationToken& token)
     {
-        if (difficulty <= 0)
-        {
-            throw std::invalid_argument("Difficulty must be positive!");
-        }
-
-        std::atomic<bool> found(false); // Волшебный звонок: "нашли ключ?"
-        std::string target(difficulty, '0'); // Образец: "00" для 2 нулей
-        int foundNonce = 0; // Коробка для номера ключа
-        std::string foundHash; // Коробка для хеша
-
-        Logger::getInstance().log("Started mining Genesis block in " + std::to_string(numThreads) + " threads");
-
-        auto mineRange = [this, &found, &target, &foundNonce, &foundHash, difficulty](int start, int step)
-        {
-            try {
-            while (!found)
-            {
-                this->nonce = start; // Проверяем число
-                std::string currentHash = calculateHash(); // Вычисляем хеш
-                if (currentHash.substr(0, difficulty) == target)
-                { // Если хеш подходит
-                    foundNonce = start; // Сохраняем номер
-                    foundHash = currentHash; // Сохраняем хеш
-                    found = true; // Звоним в звонок: "Стоп!"
-                    return;
-                }
-                start += step; // Берём следующее число (0,4,8,...)
-            }
-            }catch(const std::exception& e)
-            {
-                Logger::getInstance().log("Error in mining thread: " + std::string(e.what()));
-            }
-        };
-
-        std::vector<std::thread> threads;
-        for (int i = 0; i < numThreads; ++i)
-        {
-            threads.emplace_back(mineRange, i, numThreads); // Нанимаем 4 рабочих
-        }
+        checkBits(bits);
 
-        for (auto& t : threads)
+        Logger::getInstance().log("Started mining Genesis block in " + std::to_string(numThreads) + " threads, kernel=" +
+                                  MiningKernel::typeName(MiningKernel::getInstance().getType()));
+        if (!mineOnPool(bits, numThreads, token))
         {
-            t.join(); // Ждём, пока все закончат
+            Logger::getInstance().log("Mining of Genesis block stopped: cancelled");
+            return false;
         }
-
-        this->nonce = foundNonce; // Сохраняем номер ключа
-        this->hash = foundHash; // Сохраняем хеш
-
-        Logger::getInstance().log("Mined Genesis block: nonce=" + std::to_string(this->nonce) + ", hash=" + this->hash);
+        Logger::getInstance().log("Mined Genesis block: nonce=" + std::to_string(this->nonce) + ", hash=" + this->hash.toHex());
+        return true;
     }
     int Genesis::getIndex() const
     {
         return index;
     }
 
-    std::string Genesis::getHash() const
+    const Hash256& Genesis::getHash() const
     {
         return hash;
     }
 
-    std::string Genesis::getPrevHash()const
+    const Hash256& Genesis::getPrevHash()const
     {
         return Block::getPrevHash();
     }
@@ -5,20 +5,37 @@
 #include <thread>
 #include <atomic>
 #include <vector>
+#include <memory>
 #include "Transaction.h"
+#include "BlockHeader.h"
+#include "Hash256.h"
+#include "MiningPool.h"
 
 class Block
 {
 protected:
     int index;//number block
     long long timestamp;//time create block
-    std::vector<Transaction>transactions;//list of tranzaction
-    std::string prevHash;//hash prev block
-    std::string hash;//hash this block
-    int nonce;//for proof and work
+    std::shared_ptr<std::vector<Transaction>> transactions;//list of tranzaction; пусто после pruneBody()
+    Hash256 prevHash;//hash prev block
+    Hash256 hash;//hash this block
+    uint64_t nonce;//for proof and work: младшие 32 бита перебирает пул, старшие - extra-nonce
+    uint32_t bits;//компактная цель PoW, с которой смайнен блок (входит в заголовок)
+    HashBytes merkleRoot{};//фиксируется при майнинге/восстановлении, чтобы заголовок жил без тела
+    bool merkleRootCached = false;
+    HashBytes stateRoot{};//корень состояния после родителя, задаётся до майнинга
+    bool bodyPruned = false;
+
+    // Общий перебор nonce на MiningPool; false - только при отмене.
+    // Исчерпав 32-битный диапазон, увеличивает extra-nonce (старшие 32 бита nonce),
+    // а исчерпав и его - сдвигает timestamp и заново считает midstate.
+    bool mineOnPool(uint32_t bits, int numThreads, const CancellationToken& token);
+    static void checkBits(uint32_t bits);
+    void restoreHeader(const BlockHeader& header, const Hash256& hash); // цель, хэш, Merkle-корень и корень состояния из хранилища
 public:
-    Block (int index,long long timestamp,std::vector<Transaction>transactions,std::string prevHash,int nonce)
-        :    index(index),timestamp(timestamp),transactions(transactions),prevHash(prevHash),hash(""),nonce(nonce)
+    Block (int index,long long timestamp,std::vector<Transaction>transactions,const Hash256& prevHash,uint64_t nonce)
+        :    index(index),timestamp(timestamp),transactions(std::make_shared<std::vector<Transaction>>(std::move(transactions))),
+             prevHash(prevHash),hash(),nonce(nonce),bits(0)
     {
         if(index<0)
         {
@@ -28,25 +45,30 @@ public:
         {
             throw std::invalid_argument("block creation must be positive!");
         }
-        if(prevHash.empty())
-        {
-             throw std::invalid_argument ("theprevHash must not be blank!");
-        }
-        if(nonce<0)
-        {
-             throw std::invalid_argument("nonce must be positive!");
-        }
 
     };
 
-    virtual std::string getPrevHash()const=0;
-    virtual std::string calculateHash() const=0;//func for create hash on index, timestamp, data, prevHash и nonce
-    virtual void mineBlockParallel(int difficulty, int numThreads) = 0;
-    virtual void mineBlock(int difficulty)=0;
+    virtual const Hash256& getPrevHash()const=0;
+    virtual Hash256 calculateHash() const=0;//func for create hash on index, timestamp, data, prevHash и nonce
+    virtual bool mineBlockParallel(uint32_t bits, int numThreads, const CancellationToken& token = CancellationToken()) = 0;
+    virtual void mineBlock(uint32_t bits)=0;
     virtual int getIndex()const =0;
-    virtual std::string getHash()const =0;
+    virtual const Hash256& getHash()const =0;
     virtual const std::vector<Transaction>& getTransactions() const = 0; // get list of transactions
     void addTransaction(Transaction transaction);
+    BlockHeader getHeader() const;//бинарный заголовок с Merkle-корнем транзакций
+    long long getTimestamp() const;
+    uint32_t getBits() const;
+    uint64_t getNonce() const;
+    const HashBytes& getStateRoot() const;
+    void setStateRoot(const HashBytes& root); // до майнинга: корень входит в заголовок
+
+    // Тело блока (транзакции) можно выгрузить из памяти, заголовок и хэш остаются.
+    // getBody() отдаёт владение: читатель вне chainMutex держит тело, даже если блок тем временем
+    // выгрузят. nullptr - тело выгружено. pruneBody() и getBody() вызываются под chainMutex.
+    std::shared_ptr<const std::vector<Transaction>> getBody() const;
+    bool hasBody() const;
+    void pruneBody();
 };
 
 
@@ -56,23 +78,22 @@ public:
 class Genesis : public Block {
     friend class GenesisFactory;
 private:
-    Genesis(int index, long long timestamp, std::vector<Transaction>transactions, std::string prevHash, int nonce);
+    Genesis(int index, long long timestamp, std::vector<Transaction>transactions, const Hash256& prevHash, uint64_t nonce);
     Genesis(const Genesis&) = delete;
     Genesis& operator=(const Genesis&) = delete;
 
 public:
     static const int index;
     static const long long timestamp;
-    static constexpr std::string_view prevHash = "0";
     int getIndex() const override;
-    std::string getHash() const override;
-    std::string getPrevHash() const override ;
+    const Hash256& getHash() const override;
+    const Hash256& getPrevHash() const override ;
 
     static Genesis& getInstance();
-    std::string calculateHash() const override;
-   void mineBlockParallel(int difficulty, int numThreads) override;
-    void  mineBlock(int difficulty)override;
+    Hash256 calculateHash() const override;
+   bool mineBlockParallel(uint32_t bits, int numThreads, const CancellationToken& token = CancellationToken()) override;
+    void  mineBlock(uint32_t bits)override;
    const std::vector<Transaction>& getTransactions() const override;
 };
-//int difficulty  complexity mineng
+//uint32_t bits  compact PoW target (see BlockHeader::targetFromCompact)
 #endif // BLOCK_H
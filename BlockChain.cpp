@@ -7,44 +7,80 @@
 #include <string>
 #include "RegularBlock.h"
 #include <mutex>
-#include <nlohmann/json.hpp>
+#include <sstream>
+#include <algorithm>
+#include <filesystem>
 #include "Transaction.h"
 #include "Virtual_Machine.h"
 #include "SmartContractParser.h"
 #include "Node.h"
 
-using json = nlohmann::json;
-
 Blockchain* Blockchain::instance = nullptr;
 std::mutex Blockchain::instanceMutex;
 std::mutex Blockchain::chainMutex;
 
 Blockchain::Blockchain(int difficulty, const std::string& host, unsigned short port)
-    : difficulty(difficulty) {
+    : difficulty(difficulty), chainValidator(BlockHeader::compactFromDifficulty(1)) {
     if (difficulty <= 0) {
         throw std::invalid_argument("Difficulty must be positive!");
     }
-    auto genesis = GenesisFactory().createGenesis();
-    if (!genesis) {
-        throw std::runtime_error("Failed to create Genesis block");
-    }
-    genesis->mineBlockParallel(difficulty, 4);
-    chain.push_back(std::move(genesis));
-    Logger::getInstance().log("Initialized Blockchain with Genesis block");
     globalState["Alice"] = 10000; // Инициализируем в центах (100.0 * 100)
     globalState["Bob"] = 5000;   // Инициализируем в центах (50.0 * 100)
+    dataDirectory = "chaindata_" + std::to_string(port); // у каждой ноды свой каталог
+    blockStore = std::make_unique<BlockStore>(dataDirectory);
+    undoStore = std::make_unique<UndoStore>(dataDirectory);
+    if (blockStore->size() > 0) {
+        loadChain();
+    } else {
+        auto genesis = GenesisFactory().createGenesis();
+        if (!genesis) {
+            throw std::runtime_error("Failed to create Genesis block");
+        }
+        publishState(0); // начальные балансы
+        genesis->setStateRoot(stateTree.root());
+        if (!genesis->mineBlockParallel(BlockHeader::compactFromDifficulty(difficulty),
+                                        static_cast<int>(MiningPool::getInstance().getThreadCount()))) {
+            throw std::runtime_error("Failed to mine Genesis block");
+        }
+        blockStore->append(*genesis);
+        blockStore->sync();
+        blockIndex.add(*genesis);
+        rememberTxids(sourceTxids(genesis->getTransactions()));
+        chain.push_back(std::move(genesis));
+        Logger::getInstance().log("Initialized Blockchain with Genesis block");
+    }
     node = new Node(host, port, *this); // Создание ноды
     Logger::getInstance().log("Create node");
+    ingestionThread = std::thread(&Blockchain::ingestionLoop, this);
+    assemblerThread = std::thread(&Blockchain::assemblerLoop, this);
+    minerThread = std::thread(&Blockchain::minerLoop, this);
 }
 
 Blockchain::~Blockchain() {
     try {
+        {
+            std::lock_guard<std::mutex> lock(pipelineMutex);
+            pipelineStopping = true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(ingestionMutex);
+            ingestionStopping = true;
+        }
+        ingestionChanged.notify_one();
+        if (ingestionThread.joinable()) ingestionThread.join();
+        cancelMining();
+        pipelineChanged.notify_all();
+        if (assemblerThread.joinable()) assemblerThread.join();
+        if (minerThread.joinable()) minerThread.join();
         if (node) {
             Logger::getInstance().log("Deleting node in Blockchain destructor");
             delete node;
             node = nullptr;
         }
+        blockIndex.clear();
         chain.clear();
+        blockStore.reset(); // последний fsync недосохранённой пачки
+        undoStore.reset();
         Logger::getInstance().log("Blockchain resources cleaned up");
     } catch (const std::exception& e) {
         Logger::getInstance().log("Error in Blockchain destructor: " + std::string(e.what()));
@@ -80,152 +116,926 @@ void Blockchain::connectToPeer(const std::string& host, unsigned short port) {
     }
 }
 
-void Blockchain::addTransaction(const Transaction& tx) {
-    std::lock_guard<std::mutex> lock(chainMutex);
-    transactionPool.push_back(tx);
-    Logger::getInstance().log("Added transaction to pool: " + tx.toString());
-    if (node) {
-        node->broadcastTransaction(tx);
+void Blockchain::cancelMining() {
+    std::lock_guard<std::mutex> lock(miningTokenMutex);
+    miningToken.cancel();
+}
+
+bool Blockchain::preemptMining(const BlockHeader& header) {
+    uint32_t expectedBits;
+    {
+        std::lock_guard<std::mutex> lock(chainMutex);
+        if (header.index != chain.size() || Hash256(header.prevHash) != chain.back()->getHash()) {
+            return false;
+        }
+        expectedBits = nextBits();
+    }
+    // PoW проверяется последним: подделка без работы отсекается, не отменив майнинг
+    if (header.bits != expectedBits ||
+        !BlockHeader::meetsTarget(header.hash(), BlockHeader::targetFromCompact(header.bits))) {
+        return false;
     }
-    if (transactionPool.size() >= 2) {
-        addBlock(transactionPool);
-        transactionPool.clear();
+    cancelMining();
+    return true;
+}
+
+void Blockchain::addTransaction(Transaction tx) {
+    if (incomingTransactions.push(std::move(tx))) {
+        wakeIngestion(); // замок берёт только тот, кто застал очередь пустой
+    }
+}
+
+void Blockchain::addTransactions(std::vector<Transaction> transactions) {
+    if (incomingTransactions.push(std::move(transactions))) {
+        wakeIngestion();
+    }
+}
+
+void Blockchain::wakeIngestion() {
+    {
+        std::lock_guard<std::mutex> lock(ingestionMutex);
+        ingestionSignalled = true;
     }
+    ingestionChanged.notify_one();
+}
+
+void Blockchain::ingestionLoop() {
+    std::vector<Transaction> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(ingestionMutex);
+            ingestionChanged.wait(lock, [this] { return ingestionStopping || ingestionSignalled; });
+            if (ingestionStopping) {
+                return;
+            }
+            ingestionSignalled = false;
+        }
+        // Выбираем очередь до дна; следующий отправитель, заставший её пустой, разбудит снова
+        bool empty = false;
+        while (!empty) {
+            batch.clear();
+            incomingTransactions.drain(batch, INGESTION_BATCH);
+            if (batch.empty()) {
+                std::this_thread::yield(); // отправитель между вставкой и ссылкой на свой узел
+            } else {
+                ingestBatch(batch);
+            }
+            empty = incomingTransactions.release(batch.size());
+        }
+    }
+}
+
+void Blockchain::ingestBatch(std::vector<Transaction>& batch) {
+    std::vector<Transaction> accepted;
+    accepted.reserve(batch.size());
+    size_t rejected = 0;
+    bool sealCheck;
+    const std::shared_ptr<const StateVersion> state = getStateVersion();
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        const SealingPolicy::Config& config = sealingPolicy.getConfig();
+        const bool wasEmpty = mempool.size() == 0;
+        for (Transaction& tx : batch) {
+            // Приоритет платный: отправитель должен покрыть перевод и плату за него
+            const bool unpaid = tx.getPriorityFee() > 0 &&
+                                state->get(tx.getSender()) - static_cast<int64_t>(tx.getAmount() * 100) < tx.getPriorityFee();
+            if (unpaid || tx.getGasLimit() > config.maxGas || tx.serialize().size() > config.maxBytes || !mempool.add(tx)) {
+                ++rejected; // нечем платить, дубликат, не влезает в блок или слишком дешёвая для полного пула
+                continue;
+            }
+            accepted.push_back(std::move(tx));
+        }
+        // Первые транзакции взводят таймер maxWait у сборщика, дальше его будит только сработавший порог
+        sealCheck = (wasEmpty && mempool.size() > 0) ||
+                    sealingPolicy.check(mempool, Mempool::Clock::now()) != SealingPolicy::NONE;
+    }
+    Logger::getInstance().log("Added " + std::to_string(accepted.size()) + " transactions to mempool" +
+                              (rejected ? ", rejected " + std::to_string(rejected) : std::string()));
+    if (node && !accepted.empty()) {
+        // Отклонённые не пересылаются: повтор от пира не зацикливает рассылку
+        node->broadcastTransactions(accepted);
+    }
+    if (sealCheck) {
+        requestSeal(); // блок соберёт сборщик, когда в конвейере будет место
+    }
+}
+
+void Blockchain::requestSeal() {
+    {
+        std::lock_guard<std::mutex> lock(pipelineMutex);
+        sealRequested = true;
+    }
+    pipelineChanged.notify_all();
 }
 
 void Blockchain::addBlock(std::vector<Transaction> transactions) {
-    std::lock_guard<std::mutex> lock(chainMutex);
+    submitBlock(std::move(transactions)).get();
+}
+
+std::future<bool> Blockchain::submitBlock(std::vector<Transaction> transactions) {
     if (transactions.empty()) {
         throw std::invalid_argument("Transactions list cannot be empty!");
     }
-    Logger::getInstance().log("Chain size: " + std::to_string(chain.size()));
+    auto blockTemplate = std::make_unique<BlockTemplate>();
+    blockTemplate->transactions = std::move(transactions);
+    std::future<bool> committed = blockTemplate->committed.get_future();
+    {
+        std::lock_guard<std::mutex> lock(pipelineMutex);
+        if (pipelineStopping) {
+            throw std::runtime_error("Block production pipeline is stopped");
+        }
+        assemblyQueue.push_back(std::move(blockTemplate));
+    }
+    pipelineChanged.notify_all();
+    return committed;
+}
 
-    // Создаём вектор для транзакций с парсированным байт-кодом
-    std::vector<Transaction> parsedTransactions;
-    for (const auto& tx : transactions) {
+void Blockchain::assemblerLoop() {
+    std::optional<Mempool::Clock::time_point> sealDeadline; // когда истечёт maxWait самой старой транзакции мемпула
+    while (true) {
+        std::unique_ptr<BlockTemplate> blockTemplate;
+        {
+            std::unique_lock<std::mutex> lock(pipelineMutex);
+            auto ready = [this] {
+                return pipelineStopping ||
+                       ((!assemblyQueue.empty() || sealRequested) && miningQueue.size() < MAX_ASSEMBLED_TEMPLATES);
+            };
+            if (!sealDeadline) {
+                pipelineChanged.wait(lock, ready);
+            } else if (!pipelineChanged.wait_until(lock, *sealDeadline, ready)) {
+                // maxWait истёк: мемпул проверяется, как только в конвейере будет место
+                sealDeadline.reset();
+                sealRequested = true;
+                if (miningQueue.size() >= MAX_ASSEMBLED_TEMPLATES) {
+                    continue;
+                }
+            }
+            if (pipelineStopping) {
+                return;
+            }
+            if (!assemblyQueue.empty()) {
+                blockTemplate = std::move(assemblyQueue.front());
+                assemblyQueue.pop_front();
+            } else {
+                sealRequested = false;
+            }
+        }
+        if (!blockTemplate) {
+            blockTemplate = sealFromMempool(sealDeadline);
+            if (!blockTemplate) {
+                continue;
+            }
+        }
+        try {
+            assembleTemplate(*blockTemplate);
+        } catch (...) {
+            blockTemplate->committed.set_exception(std::current_exception());
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(pipelineMutex);
+            miningQueue.push_back(std::move(blockTemplate));
+        }
+        pipelineChanged.notify_all();
+    }
+}
+
+std::unique_ptr<Blockchain::BlockTemplate> Blockchain::sealFromMempool(std::optional<Mempool::Clock::time_point>& deadline) {
+    Mempool::Batch batch;
+    SealingPolicy::Reason reason;
+    bool more = false;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        const Mempool::Clock::time_point now = Mempool::Clock::now();
+        reason = sealingPolicy.check(mempool, now);
+        if (reason != SealingPolicy::NONE) {
+            batch = mempool.takeTop(sealingPolicy.limits());
+            if (!batch.transactions.empty()) {
+                sealingPolicy.record(reason, batch, now);
+                more = sealingPolicy.check(mempool, now) != SealingPolicy::NONE; // очередь больше одного блока
+            }
+        }
+        deadline.reset();
+        if (mempool.size() > 0 && (reason == SealingPolicy::NONE || !batch.transactions.empty())) {
+            deadline = sealingPolicy.deadline(mempool);
+        }
+    }
+    if (more) {
+        requestSeal();
+    }
+    if (reason == SealingPolicy::NONE) {
+        return nullptr;
+    }
+    if (batch.transactions.empty()) {
+        // Бывает только после ужесточения политики: оставшиеся транзакции больше нового блока
+        Logger::getInstance().log(std::string("Sealing triggered by ") + SealingPolicy::reasonName(reason) +
+                                  ", but no pending transaction fits the block limits");
+        return nullptr;
+    }
+    Logger::getInstance().log(std::string("Sealing block by ") + SealingPolicy::reasonName(reason) + ": " +
+                              std::to_string(batch.transactions.size()) + " transactions, gas " +
+                              std::to_string(batch.gas) + ", " + std::to_string(batch.bytes) + " bytes");
+    auto blockTemplate = std::make_unique<BlockTemplate>();
+    blockTemplate->transactions = std::move(batch.transactions);
+    blockTemplate->fromMempool = true;
+    blockTemplate->arrivals = std::move(batch.arrivals);
+    return blockTemplate;
+}
+
+void Blockchain::minerLoop() {
+    while (true) {
+        std::unique_ptr<BlockTemplate> blockTemplate;
+        {
+            std::unique_lock<std::mutex> lock(pipelineMutex);
+            pipelineChanged.wait(lock, [this] { return pipelineStopping || !miningQueue.empty(); });
+            if (pipelineStopping) {
+                return;
+            }
+            blockTemplate = std::move(miningQueue.front());
+            miningQueue.pop_front();
+        }
+        pipelineChanged.notify_all(); // освободилось место - сборщик может готовить следующий шаблон
+        try {
+            blockTemplate->committed.set_value(mineAndCommit(*blockTemplate));
+        } catch (...) {
+            blockTemplate->committed.set_exception(std::current_exception());
+        }
+    }
+}
+
+void Blockchain::assembleTemplate(BlockTemplate& blockTemplate) {
+    int height;
+    std::vector<int64_t> balances;
+    {
+        std::lock_guard<std::mutex> lock(chainMutex);
+        height = static_cast<int>(chain.size());
+        for (const auto& tx : blockTemplate.transactions) {
+            balances.push_back(globalState.get(tx.getSender()));
+        }
+    }
+
+    // Парсинг GLTCH идёт без chainMutex: читатели и addTransaction не ждут
+    for (size_t i = 0; i < blockTemplate.transactions.size(); ++i) {
+        const Transaction& tx = blockTemplate.transactions[i];
         if (!tx.getGltchCode().empty()) {
             Virtual_Machine::Context ctx = {
                 tx.getSender(),
                 static_cast<int64_t>(tx.getAmount() * 100),
-                globalState[tx.getSender()],
+                balances[i],
                 std::time(nullptr),
-                static_cast<int>(chain.size())
+                height
             };
             try {
                 SmartContractParser parser(ctx);
                 std::vector<uint8_t> bytecode = parser.parse(tx.getGltchCode());
-                parsedTransactions.emplace_back(
+                blockTemplate.parsedTransactions.emplace_back(
                     tx.getSender(),
                     tx.getRecipient(),
                     tx.getAmount(),
                     tx.getSignature(),
                     bytecode,
                     tx.getGasLimit(),
-                    tx.getGltchCode()
+                    tx.getGltchCode(),
+                    tx.getGasPrice()
                     );
             } catch (const std::exception& e) {
                 Logger::getInstance().log("Parser error for transaction: " + tx.toString() + ", error: " + e.what());
                 continue;
             }
         } else {
-            parsedTransactions.push_back(tx);
+            blockTemplate.parsedTransactions.push_back(tx);
+        }
+    }
+    Logger::getInstance().log("Assembled block template with " + std::to_string(blockTemplate.parsedTransactions.size()) +
+                              " transactions");
+}
+
+bool Blockchain::mineAndCommit(BlockTemplate& blockTemplate) {
+    bool tipMoved = false;
+    while (true) {
+        if (tipMoved) {
+            // GLTCH компилируется с балансом отправителя и высотой: после смены вершины разбираем заново
+            blockTemplate.parsedTransactions.clear();
+            assembleTemplate(blockTemplate);
+            tipMoved = false;
+        }
+        int height;
+        Hash256 tipHash;
+        uint32_t bits;
+        HashBytes stateRoot;
+        std::vector<Hash256> txids = sourceTxids(blockTemplate.parsedTransactions); // хэши - без замка
+        size_t dropped;
+        {
+            std::lock_guard<std::mutex> lock(chainMutex);
+            height = static_cast<int>(chain.size());
+            tipHash = chain.back()->getHash();
+            bits = nextBits();
+            stateRoot = stateTree.root(); // состояние после tipHash: меняется только вместе с вершиной
+            dropped = dropCommitted(blockTemplate.parsedTransactions, txids);
+        }
+        Logger::getInstance().log("Chain size: " + std::to_string(height));
+        if (dropped > 0) {
+            Logger::getInstance().log("Dropped " + std::to_string(dropped) + " transactions already in the chain from block " +
+                                      std::to_string(height));
+        }
+        if (blockTemplate.parsedTransactions.empty()) {
+            Logger::getInstance().log("Nothing left to mine in block " + std::to_string(height));
+            return false;
+        }
+
+        auto block = RegularBlockFactory().createRegularBlock(height, std::time(nullptr), blockTemplate.parsedTransactions, tipHash, 0);
+        if (!block) {
+            throw std::runtime_error("Failed to create RegularBlock");
+        }
+        block->setStateRoot(stateRoot);
+        CancellationToken token;
+        {
+            std::lock_guard<std::mutex> tokenLock(miningTokenMutex);
+            miningToken = token;
         }
+        // PoW считается без chainMutex
+        if (!block->mineBlockParallel(bits, static_cast<int>(MiningPool::getInstance().getThreadCount()), token)) {
+            if (!blockTemplate.fromMempool) {
+                Logger::getInstance().log("Mining of block " + std::to_string(height) + " aborted");
+                return false;
+            }
+            // Майнинг прерван: транзакции возвращаются в мемпул и попадут в следующий блок
+            // (если пул за это время заполнился более дорогими, дешёвые из них вытесняются)
+            Logger::getInstance().log("Mining of block " + std::to_string(height) + " aborted, returning " +
+                                      std::to_string(blockTemplate.transactions.size()) + " transactions to mempool");
+            const std::vector<Hash256> returnedTxids = sourceTxids(blockTemplate.transactions);
+            std::vector<size_t> returned;
+            {
+                // Их мог уже включить блок, закоммиченный за это время
+                std::lock_guard<std::mutex> lock(chainMutex);
+                for (size_t i = 0; i < returnedTxids.size(); ++i) {
+                    if (!recentTxids.count(returnedTxids[i])) {
+                        returned.push_back(i);
+                    }
+                }
+            }
+            bool sealable;
+            {
+                std::lock_guard<std::mutex> lock(poolMutex);
+                for (size_t i : returned) {
+                    mempool.add(blockTemplate.transactions[i], blockTemplate.arrivals[i]); // maxWait не начинается заново
+                }
+                sealable = mempool.size() > 0;
+            }
+            if (sealable) {
+                requestSeal();
+            }
+            return false;
+        }
+
+        std::shared_ptr<const Block> committed;
+        StateSnapshot::State snapshotState;
+        Hash256 snapshotHash;
+        bool snapshotDue = false;
+        {
+            std::lock_guard<std::mutex> lock(chainMutex);
+            if (static_cast<int>(chain.size()) != height || chain.back()->getHash() != tipHash) {
+                Logger::getInstance().log("Chain tip moved while mining block " + std::to_string(height) + ", re-mining on new tip");
+                tipMoved = true;
+                continue;
+            }
+            // Вершина та же, значит и recentTxids; повторная проверка дешёвая (хэши уже посчитаны)
+            if (std::any_of(txids.begin(), txids.end(), [this](const Hash256& txid) { return recentTxids.count(txid) != 0; })) {
+                Logger::getInstance().log("Block " + std::to_string(height) + " repeats committed transactions, re-mining");
+                tipMoved = true;
+                continue;
+            }
+            blockStore->append(*block); // сначала на диск: при ошибке записи блок не попадёт в цепочку
+            try {
+                executeBlock(*block); // при ошибке состояние уже откачено
+            } catch (...) {
+                blockStore->truncate(static_cast<uint64_t>(height)); // иначе следующий append ждал бы высоту height + 1
+                throw;
+            }
+            blockIndex.add(*block);
+            rememberTxids(std::move(txids));
+            chain.push_back(std::move(block));
+            committed = chain.back();
+            evictBodies();
+            if (height % SNAPSHOT_INTERVAL == 0) {
+                // Под замком только копия состояния, запись файла - после
+                snapshotState = globalState;
+                snapshotHash = committed->getHash();
+                snapshotDue = true;
+            }
+        }
+        Logger::getInstance().log("Added block with index=" + std::to_string(height));
+        {
+            // Блок из submitBlock мог включить транзакции, которые ещё ждут в мемпуле
+            std::lock_guard<std::mutex> lock(poolMutex);
+            for (const Transaction& tx : blockTemplate.transactions) {
+                mempool.remove(tx.getTxid());
+            }
+        }
+        if (snapshotDue) {
+            writeSnapshot(height, snapshotHash, snapshotState);
+        }
+        if (node) {
+            node->broadcastBlock(*committed); // ссылка держит блок и после отката, тело - в окне резидентных
+        }
+        return true;
     }
+}
 
-    auto block = RegularBlockFactory().createRegularBlock(chain.size(), std::time(nullptr), parsedTransactions, chain.back()->getHash(), 0);
-    if (!block) {
-        throw std::runtime_error("Failed to create RegularBlock");
+void Blockchain::setSealingPolicy(const SealingPolicy::Config& config) {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        sealingPolicy.setConfig(config);
     }
-    block->mineBlockParallel(difficulty, 4);
+    Logger::getInstance().log("Sealing policy: up to " + std::to_string(config.maxTransactions) + " transactions, gas " +
+                              std::to_string(config.maxGas) + ", " + std::to_string(config.maxBytes) + " bytes, wait " +
+                              std::to_string(config.maxWait.count()) + "ms");
+    requestSeal(); // пороги могли уже сработать на том, что лежит в мемпуле
+}
 
-    for (const auto& tx : parsedTransactions) {
-        if (!tx.getContractCode().empty()) {
-            Logger::getInstance().log("Executing contract for transaction: " + tx.toString());
-            Virtual_Machine::Context ctx = {
-                tx.getSender(),
-                static_cast<int64_t>(tx.getAmount() * 100),
-                globalState[tx.getSender()],
-                std::time(nullptr),
-                static_cast<int>(chain.size())
-            };
-            Virtual_Machine vm(tx.getContractCode(), globalState, ctx, {}, tx.getGasLimit());
-            bool success = vm.execute();
-            if (success) {
-                for (const auto& event : vm.getLog()) {
-                    Logger::getInstance().log("Event: " + event);
+SealingPolicy::Metrics Blockchain::getSealingMetrics() const {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    SealingPolicy::Metrics metrics = sealingPolicy.getMetrics();
+    metrics.pendingTransactions = mempool.size();
+    metrics.pendingBytes = mempool.pendingBytes();
+    return metrics;
+}
+
+void Blockchain::setTargetBlockInterval(int64_t seconds) {
+    if (seconds <= 0) {
+        throw std::invalid_argument("Target block interval must be positive!");
+    }
+    if (seconds > ChainValidator::MAX_TARGET_BLOCK_INTERVAL) {
+        throw std::invalid_argument("Target block interval must not exceed " +
+                                    std::to_string(ChainValidator::MAX_TARGET_BLOCK_INTERVAL) + " seconds!");
+    }
+    std::lock_guard<std::mutex> lock(chainMutex);
+    targetBlockInterval = seconds;
+}
+
+std::vector<Hash256> Blockchain::sourceTxids(const std::vector<Transaction>& transactions) {
+    std::vector<Hash256> txids;
+    txids.reserve(transactions.size());
+    for (const Transaction& tx : transactions) {
+        txids.push_back(tx.getSourceTxid());
+    }
+    return txids;
+}
+
+void Blockchain::rememberTxids(std::vector<Hash256> txids) {
+    recentTxids.insert(txids.begin(), txids.end());
+    recentTxidBlocks.push_back(std::move(txids));
+    if (recentTxidBlocks.size() > RECENT_TXID_BLOCKS) {
+        for (const Hash256& txid : recentTxidBlocks.front()) {
+            recentTxids.erase(txid);
+        }
+        recentTxidBlocks.pop_front();
+    }
+}
+
+void Blockchain::forgetTxids(size_t depth) {
+    for (; depth > 0 && !recentTxidBlocks.empty(); --depth) {
+        for (const Hash256& txid : recentTxidBlocks.back()) {
+            recentTxids.erase(txid);
+        }
+        recentTxidBlocks.pop_back();
+    }
+}
+
+size_t Blockchain::dropCommitted(std::vector<Transaction>& transactions, std::vector<Hash256>& txids) const {
+    std::unordered_set<Hash256> seen;
+    size_t kept = 0;
+    for (size_t i = 0; i < transactions.size(); ++i) {
+        if (recentTxids.count(txids[i]) || !seen.insert(txids[i]).second) {
+            continue;
+        }
+        if (kept != i) {
+            transactions[kept] = std::move(transactions[i]);
+            txids[kept] = txids[i];
+        }
+        ++kept;
+    }
+    const size_t dropped = transactions.size() - kept;
+    transactions.erase(transactions.begin() + kept, transactions.end());
+    txids.resize(kept);
+    return dropped;
+}
+
+uint32_t Blockchain::nextBits() const {
+    const Block& tip = *chain.back();
+    const size_t height = chain.size();
+    if (!ChainValidator::isRetargetHeight(height)) {
+        return tip.getBits();
+    }
+    const Block& first = *chain[height - ChainValidator::RETARGET_INTERVAL];
+    uint32_t bits = chainValidator.scheduledBits(height, tip, &first, targetBlockInterval);
+    Logger::getInstance().log("Retarget at height " + std::to_string(height) + ": actual=" +
+                              std::to_string(tip.getTimestamp() - first.getTimestamp()) + "s expected=" +
+                              std::to_string(targetBlockInterval * (ChainValidator::RETARGET_INTERVAL - 1)) + "s bits " +
+                              BlockHeader::compactToString(tip.getBits()) + " -> " + BlockHeader::compactToString(bits));
+    return bits;
+}
+
+void Blockchain::executeBlock(const Block& block) {
+    const uint64_t height = static_cast<uint64_t>(block.getIndex());
+    std::vector<StateStore::Change> changes;
+    try {
+        blockExecutor.execute(block, globalState);
+        changes = drainChanges();
+        // undo-лог пишется до публикации: если запись не удалась, блок не применён вовсе
+        undoStore->put(height, undoOf(changes));
+    } catch (...) {
+        if (changes.empty()) {
+            changes = drainChanges(); // исполнение оборвалось на середине
+        }
+        revertChanges(changes);
+        throw;
+    }
+    publishChanges(changes, height);
+}
+
+std::vector<StateStore::Change> Blockchain::drainChanges() {
+    std::vector<StateStore::Change> changes;
+    globalState.drainTouched([&changes](const StateStore::Change& change) { changes.push_back(change); });
+    return changes;
+}
+
+BlockUndo Blockchain::undoOf(const std::vector<StateStore::Change>& changes) {
+    BlockUndo undo;
+    undo.entries.reserve(changes.size());
+    for (const StateStore::Change& change : changes) {
+        undo.entries.push_back({change.key, change.existed, change.previous});
+    }
+    return undo;
+}
+
+void Blockchain::revertChanges(const std::vector<StateStore::Change>& changes) {
+    for (const StateStore::Change& change : changes) {
+        if (change.existed) {
+            globalState[change.key] = change.previous;
+        } else {
+            globalState.erase(change.key);
+        }
+    }
+    globalState.drainTouched([](const StateStore::Change&) {}); // stateTree и версия этих ключей не видели
+}
+
+void Blockchain::publishChanges(const std::vector<StateStore::Change>& changes, uint64_t height) {
+    StateVersion::Builder builder(std::atomic_load(&stateVersion), globalState.keys());
+    for (const StateStore::Change& change : changes) {
+        if (change.present) {
+            stateTree.update(change.key, change.value);
+            builder.set(change.key, change.value);
+        } else {
+            stateTree.erase(change.key);
+            builder.erase(change.key);
+        }
+    }
+    stateTree.root(); // пересчёт грязных путей здесь, а не при майнинге следующего блока
+    std::atomic_store(&stateVersion, builder.publish(height));
+}
+
+BlockUndo Blockchain::publishState(uint64_t height) {
+    std::vector<StateStore::Change> changes = drainChanges();
+    publishChanges(changes, height);
+    return undoOf(changes);
+}
+
+void Blockchain::rebuildState(uint64_t height) {
+    stateTree.rebuild(globalState);
+    StateVersion::Builder builder(nullptr, globalState.keys());
+    globalState.forEach([&builder](const std::string& key, int64_t value) { builder.set(key, value); });
+    globalState.drainTouched([](const StateStore::Change&) {});
+    std::atomic_store(&stateVersion, builder.publish(height));
+}
+
+void Blockchain::loadChain() {
+    const uint64_t height = blockStore->size();
+    Logger::getInstance().log("Loading " + std::to_string(height) + " blocks from block store");
+    const uint64_t snapshotHeight = loadSnapshot(height);
+    lastSnapshotHeight = snapshotHeight;
+    rebuildState(snapshotHeight);
+    undoStore->truncate(height); // логи блоков, потерянных при сбое
+    // Тела читаются только для блоков после снимка (их надо переиграть) и для окна резидентных тел,
+    // остальные блоки поднимаются из заголовков в индексе
+    const uint64_t windowStart = height > residentBodies ? height - residentBodies : 0;
+    size_t resident = 0;
+    for (uint64_t i = 0; i < height; ++i) {
+        const bool replay = i > snapshotHeight;
+        std::unique_ptr<Block> block;
+        if (i == 0) {
+            block = GenesisFactory().restoreGenesis(blockStore->readHeader(0), blockStore->hashAt(0));
+        } else if (replay && !blockStore->hasBody(i)) {
+            throw std::runtime_error("Body of block " + std::to_string(i) + " was pruned and no state snapshot covers it");
+        } else if (replay || (i >= windowStart && blockStore->hasBody(i))) {
+            BlockStore::StoredBlock stored = blockStore->read(i);
+            block = RegularBlockFactory().restoreRegularBlock(stored.header, stored.hash, std::move(stored.transactions));
+        } else {
+            block = RegularBlockFactory().restoreRegularHeader(blockStore->readHeader(i), blockStore->hashAt(i));
+        }
+        if (i > 0 && block->getPrevHash() != blockIndex.findByHeight(i - 1)->hash) {
+            throw std::runtime_error("Stored chain is broken at height " + std::to_string(i));
+        }
+        // Корень в заголовке - состояние до блока; без снимка проверяется вся история
+        if ((i > snapshotHeight || snapshotHeight == 0) && block->getStateRoot() != stateTree.root()) {
+            throw std::runtime_error("State root mismatch at height " + std::to_string(i) +
+                                     ": stored chain and state snapshot disagree");
+        }
+        if (i > snapshotHeight) {
+            executeBlock(*block); // блоки до снимка уже учтены в globalState
+        }
+        if (i + RECENT_TXID_BLOCKS >= height) {
+            rememberTxids(block->hasBody() ? sourceTxids(block->getTransactions()) : std::vector<Hash256>());
+        }
+        if (i < windowStart) {
+            block->pruneBody();
+        }
+        resident += block->hasBody() ? 1 : 0;
+        blockIndex.add(*block);
+        chain.push_back(std::move(block));
+    }
+    residentFrom = static_cast<size_t>(windowStart);
+    Logger::getInstance().log("Loaded chain with " + std::to_string(chain.size()) + " blocks (" +
+                              std::to_string(resident) + " bodies resident), tip " +
+                              chain.back()->getHash().toHex());
+}
+
+void Blockchain::setPruning(size_t residentBodies, bool dropPrunedBodies) {
+    if (residentBodies == 0) {
+        throw std::invalid_argument("At least one block body must stay resident!");
+    }
+    std::lock_guard<std::mutex> lock(chainMutex);
+    this->residentBodies = residentBodies;
+    this->dropPrunedBodies = dropPrunedBodies;
+    evictBodies();
+    Logger::getInstance().log("Pruning: " + std::to_string(residentBodies) + " resident bodies, older bodies " +
+                              (dropPrunedBodies ? "dropped" : "kept on disk"));
+}
+
+void Blockchain::evictBodies() {
+    // Читатели вне chainMutex держат свой shared_ptr на тело, поэтому выгрузка их не ломает
+    while (residentFrom + residentBodies < chain.size()) {
+        chain[residentFrom++]->pruneBody();
+    }
+    if (dropPrunedBodies) {
+        // С диска - только то, что уже есть в снимке: блоки после него нужны для переигровки при старте
+        blockStore->pruneBelow(std::min<uint64_t>(residentFrom, lastSnapshotHeight + 1));
+    }
+}
+
+uint64_t Blockchain::loadSnapshot(uint64_t storedHeight) {
+    for (const auto& snapshot : StateSnapshot::list(dataDirectory)) {
+        if (snapshot.first >= storedHeight) {
+            continue; // снимок новее сохранённых блоков (блоки потеряны при сбое)
+        }
+        uint64_t height = 0;
+        Hash256 tipHash;
+        StateSnapshot::State state;
+        if (!StateSnapshot::load(snapshot.second, height, tipHash, state) || height != snapshot.first) {
+            continue;
+        }
+        if (blockStore->hashAt(height) != tipHash) {
+            Logger::getInstance().log("State snapshot " + snapshot.second + " does not match stored chain, skipping");
+            continue;
+        }
+        globalState = std::move(state);
+        Logger::getInstance().log("Loaded state snapshot at height " + std::to_string(height) + ", replaying " +
+                                  std::to_string(storedHeight - 1 - height) + " blocks");
+        return height;
+    }
+    Logger::getInstance().log("No usable state snapshot, replaying from genesis");
+    return 0;
+}
+
+void Blockchain::writeSnapshot(uint64_t height, const Hash256& tipHash, const StateSnapshot::State& state) {
+    try {
+        blockStore->sync(); // снимок не должен ссылаться на блоки, которых нет на диске
+        undoStore->sync();  // и на undo-логи, которые после него уже не переиграются
+        std::string path = StateSnapshot::write(dataDirectory, height, tipHash, state);
+        StateSnapshot::prune(dataDirectory, SNAPSHOTS_KEPT);
+        lastSnapshotHeight = height;
+        Logger::getInstance().log("Wrote state snapshot " + path + " (" + std::to_string(state.size()) + " accounts)");
+    } catch (const std::exception& e) {
+        // Снимок - только ускорение старта, блок уже закоммичен
+        Logger::getInstance().log("Failed to write state snapshot at height " + std::to_string(height) + ": " + e.what());
+    }
+}
+
+void Blockchain::rollbackBlocks(size_t depth) {
+    if (depth == 0) {
+        return;
+    }
+    size_t height;
+    StateSnapshot::State snapshotState;
+    Hash256 snapshotHash;
+    bool snapshotDue = false;
+    std::vector<std::shared_ptr<const std::vector<Transaction>>> bodies; // транзакции отключённых блоков
+    {
+        std::lock_guard<std::mutex> validationLock(validationMutex);
+        std::lock_guard<std::mutex> lock(chainMutex);
+        if (depth >= chain.size()) {
+            throw std::invalid_argument("Cannot roll back " + std::to_string(depth) + " blocks: chain has " +
+                                        std::to_string(chain.size()) + " including genesis");
+        }
+        height = chain.size() - depth; // новая длина цепочки
+        // Всё, что может не получиться, - до первой правки состояния: откат либо целиком, либо никак
+        std::vector<BlockUndo> undos(depth);
+        for (size_t i = 0; i < depth; ++i) {
+            if (!undoStore->read(height + i, undos[i])) {
+                throw std::runtime_error("No undo data for block " + std::to_string(height + i));
+            }
+            std::shared_ptr<const std::vector<Transaction>> body = chain[height + i]->getBody();
+            if (!body) {
+                body = std::make_shared<const std::vector<Transaction>>(blockStore->read(height + i).transactions);
+            }
+            bodies.push_back(std::move(body));
+        }
+        blockStore->truncate(height);
+        undoStore->truncate(height);
+
+        for (size_t i = depth; i-- > 0;) {
+            for (const BlockUndo::Entry& entry : undos[i].entries) {
+                if (entry.existed) {
+                    globalState[entry.key] = entry.previous;
+                } else {
+                    globalState.erase(entry.key);
                 }
+            }
+        }
+        publishState(height - 1); // undo самого отката не нужен
+        blockIndex.truncate(height);
+        forgetTxids(depth);
+        chain.resize(height); // блоки освобождаются, когда их отпустит последний читатель
+        residentFrom = std::min(residentFrom, height);
+        validatedHeight = std::min(validatedHeight, height);
+
+        // Снимки отключённых блоков больше не соответствуют цепочке. Без них старт пришлось бы
+        // переигрывать с более старого снимка, поэтому вместо них пишется снимок новой вершины.
+        uint64_t latestSnapshot = 0;
+        for (const auto& snapshot : StateSnapshot::list(dataDirectory)) {
+            if (snapshot.first >= height) {
+                std::filesystem::remove(snapshot.second);
+                snapshotDue = true;
             } else {
-                Logger::getInstance().log("Contract execution failed for transaction: " + tx.toString());
+                latestSnapshot = std::max<uint64_t>(latestSnapshot, snapshot.first);
             }
         }
-        globalState[tx.getSender()] -= static_cast<int64_t>(tx.getAmount() * 100);
-        globalState[tx.getRecipient()] += static_cast<int64_t>(tx.getAmount() * 100);
+        lastSnapshotHeight = latestSnapshot;
+        if (snapshotDue) {
+            snapshotState = globalState;
+            snapshotHash = chain.back()->getHash();
+        }
     }
-
-    chain.push_back(std::move(block));
-    Logger::getInstance().log("Added block with index=" + std::to_string(chain.size() - 1));
-    if (node) {
-        node->broadcastBlock(chain.back());
+    Logger::getInstance().log("Rolled back " + std::to_string(depth) + " blocks, tip is now " + std::to_string(height - 1));
+    if (snapshotDue) {
+        writeSnapshot(height - 1, snapshotHash, snapshotState);
+    }
+    cancelMining(); // шаблон, который майнится, построен на отключённой вершине
+    // Транзакции отключённых блоков снова ждут включения; GLTCH перекомпилируется при сборке
+    size_t returned = 0;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        for (const auto& body : bodies) {
+            for (const Transaction& tx : *body) {
+                returned += mempool.add(tx) ? 1 : 0;
+            }
+        }
+    }
+    Logger::getInstance().log("Returned " + std::to_string(returned) + " transactions of rolled back blocks to mempool");
+    if (returned > 0) {
+        requestSeal();
     }
 }
 
 bool Blockchain::isChainValid() {
-    std::lock_guard<std::mutex> lock(chainMutex);
-    Logger::getInstance().log("Validating chain with size: " + std::to_string(chain.size()));
-    for (size_t i = 1; i < chain.size(); ++i) {
-        if (chain[i]->getPrevHash() != chain[i - 1]->getHash()) {
-            Logger::getInstance().log("Chain invalid at index=" + std::to_string(i));
+    std::lock_guard<std::mutex> validationLock(validationMutex);
+    std::vector<const Block*> pending;
+    size_t firstHeight;
+    size_t checkFrom;
+    int64_t interval;
+    {
+        // Под chainMutex только снимок указателей: блоки после коммита не меняются, а откат
+        // ждёт validationMutex, поэтому до конца проверки они не освобождаются.
+        // Перед непроверенными блоками берутся уже проверенные - для prevHash и окна пересчёта сложности
+        std::lock_guard<std::mutex> lock(chainMutex);
+        if (chain.empty()) {
             return false;
         }
+        firstHeight = validatedHeight > static_cast<size_t>(ChainValidator::RETARGET_INTERVAL)
+                          ? validatedHeight - ChainValidator::RETARGET_INTERVAL : 0;
+        checkFrom = validatedHeight - firstHeight;
+        pending.reserve(chain.size() - firstHeight);
+        for (size_t i = firstHeight; i < chain.size(); ++i) {
+            pending.push_back(chain[i].get());
+        }
+        interval = targetBlockInterval;
     }
-    if (chain.empty()) {
+    Logger::getInstance().log("Validating " + std::to_string(pending.size() - checkFrom) + " new blocks from height " +
+                              std::to_string(firstHeight + checkFrom));
+    size_t invalidHeight = 0;
+    if (!chainValidator.validate(pending, firstHeight, checkFrom, interval, invalidHeight)) {
+        Logger::getInstance().log("Chain invalid at index=" + std::to_string(invalidHeight));
         return false;
     }
-    Logger::getInstance().log("Chain is valid");
+    validatedHeight = firstHeight + pending.size();
+    Logger::getInstance().log("Chain is valid up to height " + std::to_string(validatedHeight));
     return true;
 }
 
-std::string Blockchain::getChainInfo() const {
+std::vector<Blockchain::PageEntry> Blockchain::pageBlocks(size_t fromHeight, size_t limit, size_t& height) const {
+    std::vector<PageEntry> page;
     std::lock_guard<std::mutex> lock(chainMutex);
-    json array = json::array();
-    Logger::getInstance().log("getChainInfo: chain size = " + std::to_string(chain.size()));
-    for (const auto& block : chain) {
-        Logger::getInstance().log("Processing block with index=" + std::to_string(block->getIndex()));
-        json obj;
-        obj["index"] = block->getIndex();
-        obj["hash"] = block->getHash();
-        json txArray = json::array();
-        auto transactions = block->getTransactions();
-        Logger::getInstance().log("Block has " + std::to_string(transactions.size()) + " transactions");
-        for (const auto& tx : transactions) {
-            json txObj;
-            txObj["sender"] = tx.getSender();
-            txObj["recipient"] = tx.getRecipient();
-            txObj["amount"] = tx.getAmount();
-            txObj["signature"] = tx.getSignature();
-            if (!tx.getContractCode().empty()) {
-                std::stringstream ss;
-                for (size_t i = 0; i < tx.getContractCode().size(); ++i) {
-                    ss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(tx.getContractCode()[i]);
-                    if (i < tx.getContractCode().size() - 1) ss << " ";
-                }
-                txObj["contractCode"] = ss.str();
-            }
-            if (!tx.getGltchCode().empty()) {
-                txObj["gltchCode"] = tx.getGltchCode();
-            }
-            txArray.push_back(txObj);
+    height = blockIndex.size();
+    for (size_t h = fromHeight; h < height && page.size() < limit; ++h) {
+        page.push_back({chain[h], chain[h]->getBody()});
+    }
+    return page;
+}
+
+std::shared_ptr<const std::vector<Transaction>> Blockchain::loadBody(const Block* block) const {
+    // Без chainMutex высоту блока мог занять другой блок после отката, а тело - удалиться с диска
+    BlockStore::StoredBlock stored;
+    try {
+        stored = blockStore->read(static_cast<uint64_t>(block->getIndex()));
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+    if (stored.hash != block->getHash()) {
+        return nullptr;
+    }
+    return std::make_shared<const std::vector<Transaction>>(std::move(stored.transactions));
+}
+
+std::shared_ptr<const std::vector<Transaction>> Blockchain::getBlockBody(size_t height) const {
+    std::shared_ptr<const Block> block;
+    {
+        std::lock_guard<std::mutex> lock(chainMutex);
+        if (height >= chain.size()) {
+            return nullptr;
+        }
+        block = chain[height];
+        if (auto body = block->getBody()) { // getBody - только под chainMutex
+            return body;
         }
-        obj["transactions"] = txArray;
-        array.push_back(obj);
     }
-    std::string result = array.dump(4);
-    Logger::getInstance().log("Chain info: " + result);
-    return result;
+    return loadBody(block.get());
+}
+
+size_t Blockchain::queryChain(const ChainQuery& query, std::ostream& out) const {
+    size_t height = 0;
+    std::vector<PageEntry> page = pageBlocks(query.fromHeight, std::min(query.limit, ChainQuery::MAX_LIMIT), height);
+    // Заголовки после коммита не меняются, тела удерживаются через shared_ptr,
+    // поэтому сериализация идёт без блокировки
+    out << "{\"fromHeight\":" << query.fromHeight << ",\"height\":" << height << ",\"blocks\":[";
+    for (size_t i = 0; i < page.size(); ++i) {
+        if (i > 0) out.put(',');
+        if (!page[i].body && (query.fields & ChainQuery::TRANSACTIONS)) {
+            page[i].body = loadBody(page[i].block.get());
+        }
+        ChainQuery::writeBlock(out, *page[i].block, page[i].body.get(), query.fields);
+    }
+    out << "]}";
+    return page.size();
+}
+
+std::string Blockchain::getChainInfo() const {
+    std::ostringstream out;
+    out.put('[');
+    size_t from = 0;
+    size_t height = 0;
+    do {
+        std::vector<PageEntry> page = pageBlocks(from, ChainQuery::MAX_LIMIT, height);
+        for (PageEntry& entry : page) {
+            if (from > 0) out.put(',');
+            if (!entry.body) {
+                entry.body = loadBody(entry.block.get());
+            }
+            ChainQuery::writeBlock(out, *entry.block, entry.body.get(), ChainQuery::DEFAULT_FIELDS);
+            ++from;
+        }
+    } while (from < height);
+    out.put(']');
+    Logger::getInstance().log("getChainInfo: " + std::to_string(from) + " blocks");
+    return out.str();
+}
+
+std::shared_ptr<const Block> Blockchain::getBlockByHash(const Hash256& hash) const {
+    std::lock_guard<std::mutex> lock(chainMutex);
+    const BlockMeta* meta = blockIndex.findByHash(hash);
+    return meta ? chain[meta->height] : nullptr;
+}
+
+std::shared_ptr<const Block> Blockchain::getBlockByHeight(size_t height) const {
+    std::lock_guard<std::mutex> lock(chainMutex);
+    return height < chain.size() ? chain[height] : nullptr;
+}
+
+std::shared_ptr<const StateVersion> Blockchain::getStateVersion() const {
+    return std::atomic_load(&stateVersion);
 }
 
-std::map<std::string, int64_t> Blockchain::getGlobalState() {
-    return globalState;
+std::map<std::string, int64_t> Blockchain::getGlobalState() const {
+    return getStateVersion()->toMap();
 }
 
 void Blockchain::testBlockchain() {
@@ -241,8 +1051,9 @@ void Blockchain::testBlockchain() {
 
     Logger::getInstance().log("Running testBlockchain with " + std::to_string(transactions.size()) + " transactions");
     addBlock(transactions);
-    Logger::getInstance().log("GlobalState after tests: Alice=" + std::to_string(globalState["Alice"] / 100.0) +
-                              ", Bob=" + std::to_string(globalState["Bob"] / 100.0));
+    auto state = getStateVersion();
+    Logger::getInstance().log("GlobalState after tests (height " + std::to_string(state->getHeight()) + "): Alice=" +
+                              std::to_string(state->get("Alice") / 100.0) + ", Bob=" + std::to_string(state->get("Bob") / 100.0));
 }
 
 Transaction Blockchain::createTransactionWithGLTCH(std::string sender, std::string recipient, double amount,
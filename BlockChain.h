@@ -5,45 +5,208 @@
 #include <memory>
 #include <string>
 #include "BlockFactory.h"
+#include "MiningPool.h"
 #include "Logger.h"
 #include "Block.h"
 #include "SmartContract.h"
 #include <mutex>
 #include <thread>
 #include <map>
+#include <deque>
+#include <future>
+#include <condition_variable>
 #include <cstdint>
+#include <atomic>
+#include <optional>
+#include <unordered_set>
 #include "SmartContractParser.h"
 #include "Transaction.h"
+#include "Mempool.h"
+#include "SealingPolicy.h"
+#include "TransactionQueue.h"
+#include "BlockStore.h"
+#include "UndoStore.h"
+#include "BlockIndex.h"
+#include "StateSnapshot.h"
+#include "StateStore.h"
+#include "StateTree.h"
+#include "StateVersion.h"
+#include "BlockExecutor.h"
+#include "ChainValidator.h"
+#include "ChainQuery.h"
+#include <ostream>
 
 class Node;
 
 class Blockchain {
 public:
-    void addTransaction(const Transaction& tx);
+    // Ставят транзакции в очередь приёма и сразу возвращаются: без блокировок, отправители
+    // не ждут ни друг друга, ни мемпул. В мемпул их переносит поток приёма; там же отбрасываются
+    // дубликаты, не влезающие в блок по политике запечатывания, слишком дешёвые для полного пула
+    // и те, за чей приоритет (Transaction::getPriorityFee) отправителю нечем заплатить.
+    void addTransaction(Transaction tx);
+    void addTransactions(std::vector<Transaction> transactions); // пачка - одной атомарной вставкой
     static std::mutex instanceMutex;
     static std::mutex chainMutex;
     static Blockchain& getInstance(int difficulty, const std::string& host, unsigned short port);
-    void addBlock(std::vector<Transaction> transactions);
-    bool isChainValid();
-    std::string getChainInfo() const;
-    std::map<std::string, int64_t> getGlobalState(); // Сохраняем возврат копии, как в твоём коде
+    void addBlock(std::vector<Transaction> transactions); // Ждёт, пока конвейер закоммитит блок
+    std::future<bool> submitBlock(std::vector<Transaction> transactions); // Не ждёт; false - майнинг отменён
+    bool isChainValid(); // проверяет только блоки выше отметки validatedHeight, без chainMutex
+    std::string getChainInfo() const; // вся цепочка; собирается постранично, без общего DOM
+    // Пишет {"fromHeight":..,"height":..,"blocks":[...]} в out; возвращает число блоков на странице.
+    // chainMutex держится только на время выборки указателей страницы.
+    size_t queryChain(const ChainQuery& query, std::ostream& out) const;
+    // O(1) через blockIndex; nullptr, если блока нет. Блок, отключённый rollbackBlocks, живёт,
+    // пока его держит хоть один читатель. Тело старого блока может быть выгружено (см. setPruning) -
+    // транзакции читайте через getBlockBody.
+    std::shared_ptr<const Block> getBlockByHash(const Hash256& hash) const;
+    std::shared_ptr<const Block> getBlockByHeight(size_t height) const;
+    // Транзакции блока: из памяти или из BlockStore; nullptr, если тело удалено с диска
+    // или блок отключён откатом, пока тело читалось
+    std::shared_ptr<const std::vector<Transaction>> getBlockBody(size_t height) const;
+    // В памяти держатся заголовки всех блоков и тела последних residentBodies (>= 1).
+    // Более старые тела остаются только в BlockStore, а при dropPrunedBodies удаляются и с диска
+    // (не глубже последнего снимка состояния, иначе старт не сможет переиграть блоки).
+    void setPruning(size_t residentBodies, bool dropPrunedBodies);
+    // O(1) и без chainMutex: неизменяемая версия состояния после последнего исполненного блока.
+    // Балансы и хранилище контрактов читаются из неё, коммиты блоков читателей не ждут.
+    std::shared_ptr<const StateVersion> getStateVersion() const;
+    std::map<std::string, int64_t> getGlobalState() const; // копия всей версии - только для отладки
     void testBlockchain();
     Transaction createTransactionWithGLTCH(std::string sender, std::string recipient, double amount,
                                            std::string signature, std::string gltchCode, int64_t gasLimit,
                                            Virtual_Machine::Context ctx);
     void startNode(); // Новый метод для запуска сервера ноды
     void connectToPeer(const std::string& host, unsigned short port); // Новый метод для подключения к пиру
+    void cancelMining(); // Прерывает майнинг текущего блока (например, пришёл конкурирующий блок от пира)
+    // Прерывает майнинг, только если header - настоящий преемник вершины: следующая высота,
+    // prevHash вершины, bits по расписанию и хэш в пределах цели. false - майнинг не тронут
+    bool preemptMining(const BlockHeader& header);
+    // Желаемый интервал между блоками для пересчёта сложности. Параметр консенсуса: isChainValid
+    // сверяет bits блоков с расписанием, посчитанным по нему
+    void setTargetBlockInterval(int64_t seconds);
+    // Когда блок запечатывается из мемпула (число транзакций, газ, байты, задержка) - см. SealingPolicy
+    void setSealingPolicy(const SealingPolicy::Config& config);
+    SealingPolicy::Metrics getSealingMetrics() const;
+    // Отключает depth последних блоков (смена ветки): состояние откатывается по undo-логам блоков
+    // за время, пропорциональное числу затронутых ими ключей, блоки уходят из цепочки, индекса
+    // и BlockStore, их транзакции возвращаются в мемпул. Не глубже UndoStore::KEPT_BLOCKS
+    // и не ниже тел, удалённых с диска.
+    void rollbackBlocks(size_t depth);
 
 private:
-    std::vector<Transaction> transactionPool;
+    // Шаблон блока, проходящий конвейер: сборка -> майнинг без chainMutex -> короткий коммит
+    struct BlockTemplate {
+        std::vector<Transaction> transactions;       // исходные транзакции
+        std::vector<Transaction> parsedTransactions; // с байт-кодом, скомпилированным из GLTCH
+        // Запечатан из мемпула: при отмене транзакции возвращаются туда со своим временем прихода.
+        // Транзакции submitBlock в мемпул не попадают - о них узнаёт вызывающий по false
+        bool fromMempool = false;
+        std::vector<Mempool::Clock::time_point> arrivals; // параллельно transactions, если fromMempool
+        std::promise<bool> committed;
+    };
+    static constexpr size_t MAX_ASSEMBLED_TEMPLATES = 2; // насколько сборка может опережать майнинг
+
+    // Транзакции ждут в мемпуле, пока сборщику есть куда положить шаблон: при всплеске нагрузки
+    // очередь копится там (память ограничена, дешёвые вытесняются), а не в assemblyQueue
+    Mempool mempool;
+    SealingPolicy sealingPolicy; // под poolMutex вместе с mempool
+    mutable std::mutex poolMutex;
+
+    // Приём: addTransaction(s) -> incomingTransactions -> ingestionThread пачками в mempool
+    static constexpr size_t INGESTION_BATCH = 4096; // сколько транзакций за один захват poolMutex
+    TransactionQueue incomingTransactions;
+    std::mutex ingestionMutex;
+    std::condition_variable ingestionChanged;
+    bool ingestionSignalled = false; // под ingestionMutex
+    bool ingestionStopping = false;
+    std::thread ingestionThread;
+    void wakeIngestion();
+    void ingestionLoop();
+    void ingestBatch(std::vector<Transaction>& batch);
     Node* node;
     Blockchain(int difficulty, const std::string& host, unsigned short port);
     Blockchain(const Blockchain&) = delete;
     Blockchain& operator=(const Blockchain&) = delete;
     static Blockchain* instance;
-    std::vector<std::unique_ptr<Block>> chain;
-    int difficulty;
-    std::map<std::string, int64_t> globalState;
+    std::vector<std::shared_ptr<Block>> chain; // читатели вне chainMutex держат свою ссылку
+    BlockIndex blockIndex; // хэш/высота -> блок, обновляется вместе с chain под chainMutex
+    // Исходные txid (Transaction::getSourceTxid) последних RECENT_TXID_BLOCKS блоков; под chainMutex.
+    // Шаблон, запечатанный до коммита другого блока с той же транзакцией, не исполнит её второй раз
+    static constexpr size_t RECENT_TXID_BLOCKS = 256;
+    std::unordered_set<Hash256> recentTxids;
+    std::deque<std::vector<Hash256>> recentTxidBlocks; // по блокам цепочки, последний - вершина
+    static std::vector<Hash256> sourceTxids(const std::vector<Transaction>& transactions);
+    void rememberTxids(std::vector<Hash256> txids); // txid блока, ставшего вершиной
+    void forgetTxids(size_t depth); // отключены depth последних блоков
+    // Убирает из transactions (и параллельного txids) закоммиченные и повторные; возвращает, сколько убрано
+    size_t dropCommitted(std::vector<Transaction>& transactions, std::vector<Hash256>& txids) const;
+    std::unique_ptr<BlockStore> blockStore; // chaindata_<port>: цепочка переживает перезапуск
+    std::unique_ptr<UndoStore> undoStore; // undo-логи последних блоков, рядом с blockStore
+    struct PageEntry {
+        std::shared_ptr<const Block> block;
+        std::shared_ptr<const std::vector<Transaction>> body; // nullptr - тело выгружено
+    };
+    std::vector<PageEntry> pageBlocks(size_t fromHeight, size_t limit, size_t& height) const;
+    // Из BlockStore, без chainMutex; nullptr, если тело удалено или на высоте блока уже другой блок
+    std::shared_ptr<const std::vector<Transaction>> loadBody(const Block* block) const;
+    static constexpr size_t DEFAULT_RESIDENT_BODIES = 1000;
+    size_t residentBodies = DEFAULT_RESIDENT_BODIES;
+    bool dropPrunedBodies = false;
+    size_t residentFrom = 0; // тела блоков [0, residentFrom) выгружены
+    std::atomic<uint64_t> lastSnapshotHeight{0};
+    void evictBodies(); // вызывается под chainMutex
+    void loadChain(); // поднимает блоки из blockStore и переигрывает их на globalState
+    std::string dataDirectory;
+    static constexpr uint64_t SNAPSHOT_INTERVAL = 100; // снимок globalState каждые N блоков
+    static constexpr size_t SNAPSHOTS_KEPT = 2;
+    uint64_t loadSnapshot(uint64_t storedHeight); // высота последнего применённого снимка, 0 - без снимка
+    void writeSnapshot(uint64_t height, const Hash256& tipHash, const StateSnapshot::State& state);
+    int difficulty; // стартовая сложность в ведущих hex-нулях
+    static constexpr int64_t DEFAULT_TARGET_BLOCK_INTERVAL = 10; // секунд
+    int64_t targetBlockInterval = DEFAULT_TARGET_BLOCK_INTERVAL;
+    uint32_t nextBits() const; // цель для блока chain.size(); вызывается под chainMutex
+    StateStore globalState; // аккаунты и хранилище контрактов, меняется под chainMutex
+    // Merkle-дерево над globalState. Блок высоты h несёт в заголовке корень состояния
+    // после блока h-1: майнинг не ждёт исполнения, а подмена состояния видна в следующем заголовке
+    StateTree stateTree;
+    // Текущая версия для читателей; читается и подменяется только через std::atomic_load/atomic_store
+    std::shared_ptr<const StateVersion> stateVersion;
+    // Переносит ключи, изменённые с прошлого вызова, в stateTree и новую версию height; под chainMutex.
+    // Возвращает прежние значения этих ключей - undo-лог блока.
+    BlockUndo publishState(uint64_t height);
+    // Части publishState для executeBlock: между снятием изменений и публикацией пишется undo-лог,
+    // при ошибке изменения откатываются в globalState
+    std::vector<StateStore::Change> drainChanges();
+    static BlockUndo undoOf(const std::vector<StateStore::Change>& changes);
+    void revertChanges(const std::vector<StateStore::Change>& changes);
+    void publishChanges(const std::vector<StateStore::Change>& changes, uint64_t height);
+    void rebuildState(uint64_t height); // то же с нуля по всему globalState (после загрузки снимка)
+    BlockExecutor blockExecutor; // большие блоки исполняются параллельно (Block-STM)
+    ChainValidator chainValidator; // и расписание пересчёта сложности, общее для майнинга и проверки
+    std::mutex validationMutex; // проверки идут по одной, отметка двигается только вперёд
+    size_t validatedHeight = 0; // блоки [0, validatedHeight) уже проверены
+    CancellationToken miningToken; // токен блока, который сейчас майнится
+    std::mutex miningTokenMutex;
+
+    std::deque<std::unique_ptr<BlockTemplate>> assemblyQueue;
+    std::deque<std::unique_ptr<BlockTemplate>> miningQueue;
+    std::mutex pipelineMutex;
+    std::condition_variable pipelineChanged;
+    bool pipelineStopping = false;
+    bool sealRequested = false; // мемпул надо проверить политикой запечатывания; под pipelineMutex
+    void requestSeal(); // вызывается без pipelineMutex
+    // Шаблон из мемпула, если сработала политика; иначе nullptr. deadline - когда проверить снова
+    std::unique_ptr<BlockTemplate> sealFromMempool(std::optional<Mempool::Clock::time_point>& deadline);
+    std::thread assemblerThread;
+    std::thread minerThread;
+    void assemblerLoop();
+    void minerLoop();
+    void assembleTemplate(BlockTemplate& blockTemplate);
+    bool mineAndCommit(BlockTemplate& blockTemplate);
+    // Контракты и переводы через blockExecutor + undo-лог + корень состояния; под chainMutex.
+    // Всё или ничего: при исключении globalState, stateTree и версия остаются как до блока
+    void executeBlock(const Block& block);
     ~Blockchain();
 };
 
@@ -0,0 +1,677 @@
+#include "BlockExecutor.h"
+#include "Logger.h"
+#include "StateOverlay.h"
+#include "Virtual_Machine.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Что транзакция оставила после себя, кроме записей в состояние; логируется при фиксации
+struct TxOutcome
+{
+    bool contractRan = false;
+    bool contractSucceeded = false;
+    std::vector<std::string> events;
+    std::exception_ptr error;
+};
+
+// Одна транзакция: контракт, затем перевод. Общая для последовательного и параллельного пути.
+void runTransaction(const Transaction& tx, const Block& block, StateView& state, TxOutcome& outcome)
+{
+    if (!tx.getContractCode().empty())
+    {
+        Virtual_Machine::Context ctx = {
+            tx.getSender(),
+            static_cast<int64_t>(tx.getAmount() * 100),
+            state.get(tx.getSender()),
+            block.getTimestamp(), // время блока, а не текущее: повтор при загрузке детерминирован
+            block.getIndex()
+        };
+        Virtual_Machine vm(tx.getContractCode(), state, ctx, {}, tx.getGasLimit());
+        outcome.contractRan = true;
+        outcome.contractSucceeded = vm.execute();
+        if (outcome.contractSucceeded)
+        {
+            outcome.events = vm.getLog();
+        }
+    }
+    // Плата за приоритет сжигается: иначе высокий gasPrice вытеснял бы из мемпула бесплатно
+    state.add(tx.getSender(), -static_cast<int64_t>(tx.getAmount() * 100) - tx.getPriorityFee());
+    state.add(tx.getRecipient(), static_cast<int64_t>(tx.getAmount() * 100));
+}
+
+void logOutcome(const Transaction& tx, const TxOutcome& outcome)
+{
+    if (!outcome.contractRan)
+    {
+        return;
+    }
+    Logger::getInstance().log("Executing contract for transaction: " + tx.toString());
+    if (outcome.contractSucceeded)
+    {
+        for (const auto& event : outcome.events)
+        {
+            Logger::getInstance().log("Event: " + event);
+        }
+    }
+    else
+    {
+        Logger::getInstance().log("Contract execution failed for transaction: " + tx.toString());
+    }
+}
+
+struct Version
+{
+    size_t txn;
+    int incarnation;
+};
+
+struct ReadDescriptor
+{
+    std::string key;
+    bool fromBase; // значение взято из StateStore, а не из записи более ранней транзакции
+    Version version;
+};
+
+using WriteSet = std::vector<std::pair<std::string, int64_t>>;
+
+// Чтение записи, помеченной ESTIMATE: писатель будет перезапущен, читатель ждёт его
+struct DependencyAbort
+{
+    size_t blockingTxn;
+};
+
+// Многоверсионная память: ключ -> (номер транзакции -> значение), шардирована по ключу
+class MVMemory
+{
+public:
+    enum class ReadStatus { OK, NOT_FOUND, ESTIMATE };
+
+    explicit MVMemory(size_t transactions)
+        : lastWritten(transactions), lastReads(transactions), txnMutexes(new std::mutex[transactions])
+    {
+    }
+
+    // Последняя запись ключа транзакцией < txn
+    ReadStatus read(const std::string& key, size_t txn, Version& version, int64_t& value) const
+    {
+        const Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.data.find(key);
+        if (it == shard.data.end())
+        {
+            return ReadStatus::NOT_FOUND;
+        }
+        auto entry = it->second.lower_bound(txn);
+        if (entry == it->second.begin())
+        {
+            return ReadStatus::NOT_FOUND;
+        }
+        --entry;
+        version = {entry->first, entry->second.incarnation};
+        if (entry->second.estimate)
+        {
+            return ReadStatus::ESTIMATE;
+        }
+        value = entry->second.value;
+        return ReadStatus::OK;
+    }
+
+    // Публикует результат инкарнации; true, если записан ключ, которого прошлая инкарнация не писала
+    bool record(const Version& version, std::vector<ReadDescriptor> reads, const WriteSet& writes)
+    {
+        std::vector<std::string> written;
+        written.reserve(writes.size());
+        for (const auto& write : writes)
+        {
+            Shard& shard = shardFor(write.first);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.data[write.first][version.txn] = {version.incarnation, write.second, false};
+            written.push_back(write.first);
+        }
+        std::sort(written.begin(), written.end());
+
+        std::lock_guard<std::mutex> lock(txnMutexes[version.txn]);
+        std::vector<std::string>& previous = lastWritten[version.txn];
+        for (const auto& key : previous)
+        {
+            if (!std::binary_search(written.begin(), written.end(), key))
+            {
+                Shard& shard = shardFor(key);
+                std::lock_guard<std::mutex> shardLock(shard.mutex);
+                shard.data[key].erase(version.txn);
+            }
+        }
+        bool wroteNewLocation = false;
+        for (const auto& key : written)
+        {
+            if (!std::binary_search(previous.begin(), previous.end(), key))
+            {
+                wroteNewLocation = true;
+                break;
+            }
+        }
+        previous.swap(written);
+        lastReads[version.txn] = std::move(reads);
+        return wroteNewLocation;
+    }
+
+    void convertWritesToEstimates(size_t txn)
+    {
+        std::lock_guard<std::mutex> lock(txnMutexes[txn]);
+        for (const auto& key : lastWritten[txn])
+        {
+            Shard& shard = shardFor(key);
+            std::lock_guard<std::mutex> shardLock(shard.mutex);
+            shard.data[key][txn].estimate = true;
+        }
+    }
+
+    // Все ли прочитанные версии всё ещё последние видимые для txn
+    bool validateReadSet(size_t txn) const
+    {
+        std::vector<ReadDescriptor> reads;
+        {
+            std::lock_guard<std::mutex> lock(txnMutexes[txn]);
+            reads = lastReads[txn];
+        }
+        for (const auto& read : reads)
+        {
+            Version version{0, 0};
+            int64_t value = 0;
+            const ReadStatus status = this->read(read.key, txn, version, value);
+            if (read.fromBase ? status != ReadStatus::NOT_FOUND
+                              : status != ReadStatus::OK || version.txn != read.version.txn ||
+                                    version.incarnation != read.version.incarnation)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    struct Entry
+    {
+        int incarnation;
+        int64_t value;
+        bool estimate;
+    };
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, std::map<size_t, Entry>> data;
+    };
+    static constexpr size_t SHARDS = 64;
+
+    Shard shards[SHARDS];
+    std::vector<std::vector<std::string>> lastWritten; // отсортированы
+    std::vector<std::vector<ReadDescriptor>> lastReads;
+    std::unique_ptr<std::mutex[]> txnMutexes;
+
+    Shard& shardFor(const std::string& key) { return shards[std::hash<std::string>()(key) % SHARDS]; }
+    const Shard& shardFor(const std::string& key) const { return shards[std::hash<std::string>()(key) % SHARDS]; }
+};
+
+// Состояние одной инкарнации транзакции: свои записи с журналом (для отката контракта),
+// чтения - из своих записей, затем из MVMemory, затем из базового StateStore.
+// База во время параллельного исполнения только читается.
+class SpeculativeState : public StateView
+{
+public:
+    SpeculativeState(const MVMemory& memory, const StateStore& base, size_t txn) : memory(memory), base(base), txn(txn) {}
+
+    int64_t get(std::string_view key) const override
+    {
+        auto own = positions.find(key);
+        if (own != positions.end())
+        {
+            return writes[own->second].second;
+        }
+        auto cached = readCache.find(key);
+        if (cached != readCache.end())
+        {
+            return cached->second; // повторное чтение внутри инкарнации видит то же значение
+        }
+        std::string name(key);
+        Version version{0, 0};
+        int64_t value = 0;
+        switch (memory.read(name, txn, version, value))
+        {
+        case MVMemory::ReadStatus::ESTIMATE:
+            throw DependencyAbort{version.txn};
+        case MVMemory::ReadStatus::OK:
+            reads.push_back({name, false, version});
+            break;
+        case MVMemory::ReadStatus::NOT_FOUND:
+            value = base.get(name);
+            reads.push_back({name, true, version});
+            break;
+        }
+        readCache.emplace(std::move(name), value);
+        return value;
+    }
+
+    void set(std::string_view key, int64_t value) override
+    {
+        auto own = positions.find(key);
+        if (own != positions.end())
+        {
+            journal.push_back({own->second, false, writes[own->second].second});
+            writes[own->second].second = value;
+            return;
+        }
+        journal.push_back({writes.size(), true, 0});
+        positions.emplace(std::string(key), writes.size());
+        writes.emplace_back(std::string(key), value);
+    }
+
+    size_t checkpoint() const override { return journal.size(); }
+
+    void revertTo(size_t checkpoint) override
+    {
+        while (journal.size() > checkpoint)
+        {
+            const UndoEntry& undo = journal.back();
+            if (undo.created)
+            {
+                positions.erase(writes.back().first);
+                writes.pop_back();
+            }
+            else
+            {
+                writes[undo.position].second = undo.previous;
+            }
+            journal.pop_back();
+        }
+    }
+
+    const WriteSet& getWrites() const { return writes; }
+    std::vector<ReadDescriptor> takeReads() { return std::move(reads); }
+
+private:
+    struct UndoEntry
+    {
+        size_t position;
+        bool created;
+        int64_t previous;
+    };
+
+    const MVMemory& memory;
+    const StateStore& base;
+    size_t txn;
+    WriteSet writes; // в порядке первой записи
+    std::map<std::string, size_t, std::less<>> positions;
+    std::vector<UndoEntry> journal;
+    mutable std::vector<ReadDescriptor> reads;
+    mutable std::map<std::string, int64_t, std::less<>> readCache;
+};
+
+// Планировщик Block-STM: общие счётчики следующей транзакции на исполнение и на проверку,
+// статус и список ждущих транзакций на каждую транзакцию блока.
+class Scheduler
+{
+public:
+    enum class TaskKind { NONE, EXECUTE, VALIDATE };
+    struct Task
+    {
+        TaskKind kind = TaskKind::NONE;
+        Version version{0, 0};
+    };
+
+    explicit Scheduler(size_t transactions) : transactions(transactions), txns(new TxnState[transactions]) {}
+
+    bool isDone() const { return doneMarker.load(); }
+
+    Task nextTask()
+    {
+        Task task;
+        if (validationIdx.load() < executionIdx.load())
+        {
+            if (nextVersionToValidate(task.version)) task.kind = TaskKind::VALIDATE;
+        }
+        else if (nextVersionToExecute(task.version))
+        {
+            task.kind = TaskKind::EXECUTE;
+        }
+        return task;
+    }
+
+    // false - blocking уже исполнена, транзакцию можно сразу перезапустить
+    bool addDependency(size_t txn, size_t blocking)
+    {
+        {
+            // blocking < txn: замки всегда берутся от меньшего номера к большему
+            std::lock_guard<std::mutex> blockingLock(txns[blocking].mutex);
+            if (txns[blocking].status == Status::EXECUTED)
+            {
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(txns[txn].mutex);
+            txns[txn].status = Status::ABORTING;
+            txns[blocking].dependencies.push_back(txn);
+        }
+        --activeTasks;
+        return true;
+    }
+
+    Task finishExecution(size_t txn, int incarnation, bool wroteNewLocation)
+    {
+        std::vector<size_t> dependencies;
+        {
+            std::lock_guard<std::mutex> lock(txns[txn].mutex);
+            txns[txn].status = Status::EXECUTED;
+            dependencies.swap(txns[txn].dependencies);
+        }
+        resumeDependencies(dependencies);
+        if (validationIdx.load() > txn)
+        {
+            if (!wroteNewLocation)
+            {
+                return {TaskKind::VALIDATE, {txn, incarnation}}; // проверить только её
+            }
+            decreaseValidationIdx(txn); // новые ключи могли сломать чтения следующих транзакций
+        }
+        --activeTasks;
+        return Task();
+    }
+
+    bool tryValidationAbort(size_t txn, int incarnation)
+    {
+        std::lock_guard<std::mutex> lock(txns[txn].mutex);
+        if (txns[txn].incarnation == incarnation && txns[txn].status == Status::EXECUTED)
+        {
+            txns[txn].status = Status::ABORTING;
+            return true;
+        }
+        return false;
+    }
+
+    Task finishValidation(size_t txn, bool aborted)
+    {
+        if (aborted)
+        {
+            setReadyStatus(txn);
+            decreaseValidationIdx(txn + 1);
+            Task task;
+            if (executionIdx.load() > txn && tryIncarnate(txn, task.version))
+            {
+                task.kind = TaskKind::EXECUTE;
+                return task;
+            }
+        }
+        --activeTasks;
+        return Task();
+    }
+
+private:
+    enum class Status { READY_TO_EXECUTE, EXECUTING, EXECUTED, ABORTING };
+    struct TxnState
+    {
+        std::mutex mutex;
+        int incarnation = 0;
+        Status status = Status::READY_TO_EXECUTE;
+        std::vector<size_t> dependencies; // ждут перезапуска этой транзакции
+    };
+
+    const size_t transactions;
+    std::unique_ptr<TxnState[]> txns;
+    std::atomic<size_t> executionIdx{0};
+    std::atomic<size_t> validationIdx{0};
+    std::atomic<size_t> decreaseCount{0};
+    std::atomic<size_t> activeTasks{0};
+    std::atomic<bool> doneMarker{false};
+
+    bool tryIncarnate(size_t txn, Version& version)
+    {
+        if (txn >= transactions)
+        {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(txns[txn].mutex);
+        if (txns[txn].status != Status::READY_TO_EXECUTE)
+        {
+            return false;
+        }
+        txns[txn].status = Status::EXECUTING;
+        version = {txn, txns[txn].incarnation};
+        return true;
+    }
+
+    bool nextVersionToExecute(Version& version)
+    {
+        if (executionIdx.load() >= transactions)
+        {
+            checkDone();
+            return false;
+        }
+        ++activeTasks;
+        if (tryIncarnate(executionIdx.fetch_add(1), version))
+        {
+            return true;
+        }
+        --activeTasks;
+        return false;
+    }
+
+    bool nextVersionToValidate(Version& version)
+    {
+        if (validationIdx.load() >= transactions)
+        {
+            checkDone();
+            return false;
+        }
+        ++activeTasks;
+        const size_t txn = validationIdx.fetch_add(1);
+        if (txn < transactions)
+        {
+            std::lock_guard<std::mutex> lock(txns[txn].mutex);
+            if (txns[txn].status == Status::EXECUTED)
+            {
+                version = {txn, txns[txn].incarnation};
+                return true;
+            }
+        }
+        --activeTasks;
+        return false;
+    }
+
+    void checkDone()
+    {
+        const size_t observed = decreaseCount.load();
+        if (std::min(executionIdx.load(), validationIdx.load()) >= transactions && activeTasks.load() == 0 &&
+            observed == decreaseCount.load())
+        {
+            doneMarker.store(true);
+        }
+    }
+
+    void setReadyStatus(size_t txn)
+    {
+        std::lock_guard<std::mutex> lock(txns[txn].mutex);
+        ++txns[txn].incarnation;
+        txns[txn].status = Status::READY_TO_EXECUTE;
+    }
+
+    void resumeDependencies(const std::vector<size_t>& dependencies)
+    {
+        if (dependencies.empty())
+        {
+            return;
+        }
+        for (size_t txn : dependencies)
+        {
+            setReadyStatus(txn);
+        }
+        decreaseExecutionIdx(*std::min_element(dependencies.begin(), dependencies.end()));
+    }
+
+    static void decreaseTo(std::atomic<size_t>& index, size_t target)
+    {
+        size_t current = index.load();
+        while (current > target && !index.compare_exchange_weak(current, target)) {}
+    }
+
+    void decreaseExecutionIdx(size_t target)
+    {
+        decreaseTo(executionIdx, target);
+        ++decreaseCount;
+    }
+
+    void decreaseValidationIdx(size_t target)
+    {
+        decreaseTo(validationIdx, target);
+        ++decreaseCount;
+    }
+};
+
+}
+
+BlockExecutor::BlockExecutor(size_t maxThreads)
+    : maxThreads(maxThreads > 0 ? maxThreads : std::max(1u, std::thread::hardware_concurrency()))
+{
+}
+
+void BlockExecutor::execute(const Block& block, StateStore& state) const
+{
+    const size_t count = block.getTransactions().size();
+    const size_t threads = std::min(maxThreads, count / TRANSACTIONS_PER_THREAD);
+    if (threads <= 1)
+    {
+        executeSerial(block, state);
+    }
+    else
+    {
+        executeParallel(block, state, threads);
+    }
+}
+
+void BlockExecutor::executeSerial(const Block& block, StateStore& state) const
+{
+    // Изменения блока копятся в слое поверх state; контракт откатывается до своей метки
+    StateOverlay blockState(state);
+    for (const auto& tx : block.getTransactions())
+    {
+        TxOutcome outcome;
+        runTransaction(tx, block, blockState, outcome);
+        logOutcome(tx, outcome);
+    }
+    blockState.commit();
+}
+
+void BlockExecutor::executeParallel(const Block& block, StateStore& state, size_t threads) const
+{
+    const std::vector<Transaction>& transactions = block.getTransactions();
+    const size_t count = transactions.size();
+    MVMemory memory(count);
+    Scheduler scheduler(count);
+    std::vector<TxOutcome> outcomes(count);
+    std::vector<WriteSet> finalWrites(count);
+    std::atomic<size_t> executions{0};
+
+    auto tryExecute = [&](const Version& version) -> Scheduler::Task {
+        while (true)
+        {
+            SpeculativeState view(memory, state, version.txn);
+            TxOutcome outcome;
+            try
+            {
+                runTransaction(transactions[version.txn], block, view, outcome);
+            }
+            catch (const DependencyAbort& abort)
+            {
+                if (scheduler.addDependency(version.txn, abort.blockingTxn))
+                {
+                    return Scheduler::Task(); // продолжит тот, кто перезапустит blocking
+                }
+                continue; // blocking уже исполнена - читаем заново
+            }
+            catch (...)
+            {
+                // Ошибка могла быть следствием несогласованного чтения: решит проверка,
+                // а до фиксации доживёт только ошибка проверенной инкарнации
+                outcome.error = std::current_exception();
+            }
+            ++executions;
+            // Транзакцию в статусе EXECUTING исполняет только один поток
+            outcomes[version.txn] = std::move(outcome);
+            finalWrites[version.txn] = view.getWrites();
+            const bool wroteNewLocation = memory.record(version, view.takeReads(), view.getWrites());
+            return scheduler.finishExecution(version.txn, version.incarnation, wroteNewLocation);
+        }
+    };
+
+    auto needsReexecution = [&](const Version& version) -> Scheduler::Task {
+        const bool aborted = !memory.validateReadSet(version.txn) &&
+                             scheduler.tryValidationAbort(version.txn, version.incarnation);
+        if (aborted)
+        {
+            memory.convertWritesToEstimates(version.txn);
+        }
+        return scheduler.finishValidation(version.txn, aborted);
+    };
+
+    auto worker = [&]() {
+        Scheduler::Task task;
+        while (!scheduler.isDone())
+        {
+            if (task.kind == Scheduler::TaskKind::EXECUTE)
+            {
+                task = tryExecute(task.version);
+            }
+            else if (task.kind == Scheduler::TaskKind::VALIDATE)
+            {
+                task = needsReexecution(task.version);
+            }
+            if (task.kind == Scheduler::TaskKind::NONE)
+            {
+                task = scheduler.nextTask();
+                if (task.kind == Scheduler::TaskKind::NONE)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; ++t)
+    {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers)
+    {
+        thread.join();
+    }
+
+    // Фиксация в порядке блока: как и при последовательном исполнении, ошибка транзакции
+    // отменяет весь блок
+    StateOverlay blockState(state);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (outcomes[i].error)
+        {
+            std::rethrow_exception(outcomes[i].error);
+        }
+        logOutcome(transactions[i], outcomes[i]);
+        for (const auto& write : finalWrites[i])
+        {
+            blockState.set(write.first, write.second);
+        }
+    }
+    blockState.commit();
+    Logger::getInstance().log("Executed " + std::to_string(count) + " transactions of block " +
+                              std::to_string(block.getIndex()) + " on " + std::to_string(threads) + " threads (" +
+                              std::to_string(executions.load() - count) + " re-executions)");
+}
@@ -0,0 +1,35 @@
+#ifndef BLOCKEXECUTOR_H
+#define BLOCKEXECUTOR_H
+#include <cstddef>
+#include <cstdint>
+#include "Block.h"
+#include "StateStore.h"
+#include "StateView.h"
+
+// Исполнение транзакций блока (контракт + перевод) с фиксацией в state.
+//
+// Маленькие блоки идут последовательно через StateOverlay. Большие - по схеме Block-STM:
+// транзакции спекулятивно исполняются на нескольких потоках поверх многоверсионной памяти
+// (значение ключа, записанное транзакцией i, видно транзакциям > i), наборы чтения
+// и записи собираются из SLOAD/SSTORE и переводов. После исполнения транзакция
+// проверяется: если прочитанные версии изменились, её записи помечаются как ESTIMATE
+// и она перезапускается; читатель ESTIMATE ждёт перезапуска писателя. Итог фиксируется
+// в порядке блока и совпадает с последовательным исполнением.
+class BlockExecutor
+{
+public:
+    static constexpr size_t TRANSACTIONS_PER_THREAD = 4; // меньше - поток не окупается
+
+    explicit BlockExecutor(size_t maxThreads = 0); // 0 - по числу ядер
+
+    // Исключение из транзакции пробрасывается, state при этом не меняется
+    void execute(const Block& block, StateStore& state) const;
+
+private:
+    size_t maxThreads;
+
+    void executeSerial(const Block& block, StateStore& state) const;
+    void executeParallel(const Block& block, StateStore& state, size_t threads) const;
+};
+
+#endif // BLOCKEXECUTOR_H
@@ -9,16 +9,41 @@
 std::unique_ptr<Block> GenesisFactory::createGenesis() const
 {
     Logger::getInstance().log("Created block type: GENESIS BLOCK");
-    return std::unique_ptr<Block>(new Genesis(0, std::time(nullptr), std::vector<Transaction>{}, "0", 0));
+    return std::unique_ptr<Block>(new Genesis(0, std::time(nullptr), std::vector<Transaction>{}, Hash256(), 0));
+}
+
+std::unique_ptr<Block> GenesisFactory::restoreGenesis(const BlockHeader& header, const Hash256& hash) const
+{
+    std::unique_ptr<Genesis> genesis(new Genesis(0, header.timestamp, std::vector<Transaction>{}, Hash256(header.prevHash), header.nonce));
+    genesis->restoreHeader(header, hash);
+    return genesis;
 }
 
 // Реализация RegularBlockFactory
-std::unique_ptr<Block> RegularBlockFactory::createRegularBlock(int index, long long timestamp, std::vector<Transaction> transactions, std::string prevHash, int nonce) const
+std::unique_ptr<Block> RegularBlockFactory::createRegularBlock(int index, long long timestamp, std::vector<Transaction> transactions, const Hash256& prevHash, uint64_t nonce) const
 {
     Logger::getInstance().log("Created block type: REGULAR BLOCK");
     return std::unique_ptr<Block>(new RegularBlock(index, timestamp, transactions, prevHash, nonce));
 }
 
+std::unique_ptr<Block> RegularBlockFactory::restoreRegularBlock(const BlockHeader& header, const Hash256& hash, std::vector<Transaction> transactions) const
+{
+    std::unique_ptr<RegularBlock> block(new RegularBlock(static_cast<int>(header.index), header.timestamp, std::move(transactions),
+                                                         Hash256(header.prevHash), header.nonce));
+    block->bits = header.bits;
+    block->hash = hash;
+    // Корень считается по телу, а не берётся из записи: проверка хэша ловит подмену транзакций
+    block->merkleRoot = BlockHeader::computeMerkleRoot(block->getTransactions());
+    block->merkleRootCached = true;
+    block->stateRoot = header.stateRoot;
+    return block;
+}
+
+std::unique_ptr<Block> RegularBlockFactory::restoreRegularHeader(const BlockHeader& header, const Hash256& hash) const
+{
+    return std::unique_ptr<Block>(new RegularBlock(header, hash));
+}
+
 // Реализация BlockChainFactory
 Blockchain& BlockChainFactory::createBlockChain(int difficulty,const std::string& host, unsigned short port) const
 {
@@ -46,7 +71,7 @@ std::unique_ptr<Block> GeneralFactory::createGenesis() const
     return genesisFactory.createGenesis();
 }
 
-std::unique_ptr<Block> GeneralFactory::createRegularBlock(int index, long long timestamp, std::vector<Transaction> transactions, std::string prevHash, int nonce) const
+std::unique_ptr<Block> GeneralFactory::createRegularBlock(int index, long long timestamp, std::vector<Transaction> transactions, const Hash256& prevHash, uint64_t nonce) const
 {
     return regularBlockFactory.createRegularBlock(index, timestamp, transactions, prevHash, nonce);
 }
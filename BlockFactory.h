@@ -10,12 +10,17 @@ class GenesisFactory
 {
 public:
     std::unique_ptr<Block> createGenesis() const;
+    std::unique_ptr<Block> restoreGenesis(const BlockHeader& header, const Hash256& hash) const; // из BlockStore
 };
 
 class RegularBlockFactory
 {
 public:
-    std::unique_ptr<Block> createRegularBlock(int index, long long timestamp, std::vector<Transaction> transactions, std::string prevHash, int nonce) const;
+    std::unique_ptr<Block> createRegularBlock(int index, long long timestamp, std::vector<Transaction> transactions, const Hash256& prevHash, uint64_t nonce) const;
+    // Уже смайненный блок из BlockStore: цель и хэш берутся из записи
+    std::unique_ptr<Block> restoreRegularBlock(const BlockHeader& header, const Hash256& hash, std::vector<Transaction> transactions) const;
+    // Блок без тела (старше окна резидентных тел): транзакции при необходимости читаются из BlockStore
+    std::unique_ptr<Block> restoreRegularHeader(const BlockHeader& header, const Hash256& hash) const;
 };
 
 class BlockChainFactory
@@ -38,7 +43,7 @@ private:
 public:
     static GeneralFactory& getInstance();
     std::unique_ptr<Block> createGenesis() const;
-    std::unique_ptr<Block> createRegularBlock(int index, long long timestamp, std::vector<Transaction> transactions, std::string prevHash, int nonce) const;
+    std::unique_ptr<Block> createRegularBlock(int index, long long timestamp, std::vector<Transaction> transactions, const Hash256& prevHash, uint64_t nonce) const;
     Blockchain& createBlockchain(int difficulty, const std::string& host, unsigned short port) const;
 };
 GeneralFactory& getGeneralFactory();
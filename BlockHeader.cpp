@@ -0,0 +1,331 @@
+#include "BlockHeader.h"
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+void writeLE32(uint8_t* out, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+void writeLE64(uint8_t* out, uint64_t value)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint32_t readLE32(const uint8_t* in)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        value |= uint32_t(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+uint64_t readLE64(const uint8_t* in)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        value |= uint64_t(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+// a * b / c без 128-битных типов: произведение собирается из 32-битных половин в два слова,
+// затем делится сдвигом и вычитанием. Частное должно помещаться в 64 бита
+uint64_t mulDiv(uint64_t a, uint64_t b, uint64_t c)
+{
+    const uint64_t low = (a & 0xffffffff) * (b & 0xffffffff);
+    const uint64_t cross1 = (a & 0xffffffff) * (b >> 32);
+    const uint64_t cross2 = (a >> 32) * (b & 0xffffffff);
+    const uint64_t middle = (low >> 32) + (cross1 & 0xffffffff) + (cross2 & 0xffffffff);
+    const uint64_t productLow = (low & 0xffffffff) | (middle << 32);
+    const uint64_t productHigh = (a >> 32) * (b >> 32) + (cross1 >> 32) + (cross2 >> 32) + (middle >> 32);
+
+    uint64_t quotient = 0;
+    uint64_t remainder = 0;
+    for (int i = 127; i >= 0; --i)
+    {
+        const uint64_t bit = i >= 64 ? (productHigh >> (i - 64)) & 1 : (productLow >> i) & 1;
+        const bool overflow = (remainder >> 63) != 0; // остаток после сдвига не влез в 64 бита, но он < 2c
+        remainder = (remainder << 1) | bit;
+        quotient <<= 1;
+        if (overflow || remainder >= c)
+        {
+            remainder -= c;
+            quotient |= 1;
+        }
+    }
+    return quotient;
+}
+
+}
+
+std::array<uint8_t, BlockHeader::SIZE> BlockHeader::serialize() const
+{
+    std::array<uint8_t, SIZE> out{};
+    writeLE32(&out[0], version);
+    writeLE32(&out[4], index);
+    writeLE64(&out[8], static_cast<uint64_t>(timestamp));
+    std::memcpy(&out[16], prevHash.data(), prevHash.size());
+    std::memcpy(&out[48], merkleRoot.data(), merkleRoot.size());
+    std::memcpy(&out[80], stateRoot.data(), stateRoot.size());
+    writeLE32(&out[112], bits);
+    writeLE64(&out[NONCE_OFFSET], nonce);
+    return out;
+}
+
+BlockHeader BlockHeader::deserialize(const uint8_t* data)
+{
+    BlockHeader header;
+    header.version = readLE32(&data[0]);
+    // Раскладка и хэш известны только для текущей версии: чужой заголовок нельзя хэшировать как v2
+    if (header.version != CURRENT_VERSION)
+    {
+        throw std::runtime_error("Unsupported block header version " + std::to_string(header.version));
+    }
+    header.index = readLE32(&data[4]);
+    header.timestamp = static_cast<int64_t>(readLE64(&data[8]));
+    std::memcpy(header.prevHash.data(), &data[16], header.prevHash.size());
+    std::memcpy(header.merkleRoot.data(), &data[48], header.merkleRoot.size());
+    std::memcpy(header.stateRoot.data(), &data[80], header.stateRoot.size());
+    header.bits = readLE32(&data[112]);
+    header.nonce = readLE64(&data[NONCE_OFFSET]);
+    return header;
+}
+
+HashBytes BlockHeader::hash() const
+{
+    auto bytes = serialize();
+    return sha256d(bytes.data(), bytes.size());
+}
+
+HashBytes BlockHeader::sha256d(const uint8_t* data, size_t length)
+{
+    HashBytes first;
+    HashBytes second;
+    SHA256(data, length, first.data());
+    SHA256(first.data(), first.size(), second.data());
+    return second;
+}
+
+HashBytes BlockHeader::computeMerkleRoot(const std::vector<Transaction>& transactions)
+{
+    HashBytes root{};
+    if (transactions.empty())
+    {
+        return root;
+    }
+    std::vector<HashBytes> level;
+    level.reserve(transactions.size());
+    for (const auto& tx : transactions)
+    {
+        level.push_back(tx.getTxid().getBytes()); // txid уже посчитан при создании транзакции
+    }
+    // Как в Bitcoin: при нечётном числе узлов последний дублируется
+    while (level.size() > 1)
+    {
+        if (level.size() % 2 != 0)
+        {
+            level.push_back(level.back());
+        }
+        std::vector<HashBytes> next;
+        next.reserve(level.size() / 2);
+        uint8_t pair[2 * SHA256_DIGEST_LENGTH];
+        for (size_t i = 0; i < level.size(); i += 2)
+        {
+            std::memcpy(pair, level[i].data(), SHA256_DIGEST_LENGTH);
+            std::memcpy(pair + SHA256_DIGEST_LENGTH, level[i + 1].data(), SHA256_DIGEST_LENGTH);
+            next.push_back(sha256d(pair, sizeof(pair)));
+        }
+        level.swap(next);
+    }
+    return level.front();
+}
+
+HashBytes BlockHeader::targetFromDifficulty(int difficulty)
+{
+    HashBytes target;
+    target.fill(0xff);
+    for (int nibble = 0; nibble < difficulty && nibble < 2 * static_cast<int>(target.size()); ++nibble)
+    {
+        target[nibble / 2] &= (nibble % 2 == 0) ? 0x0f : 0x00;
+    }
+    return target;
+}
+
+bool BlockHeader::meetsTarget(const HashBytes& hash, const HashBytes& target)
+{
+    return std::memcmp(hash.data(), target.data(), hash.size()) <= 0;
+}
+
+HashBytes BlockHeader::targetFromCompact(uint32_t bits)
+{
+    HashBytes target{};
+    uint32_t exponent = bits >> 24;
+    uint32_t mantissa = bits & 0x007fffff; // старший бит мантиссы - знак, цели всегда положительны
+    if (exponent <= 3)
+    {
+        mantissa >>= 8 * (3 - exponent);
+        exponent = 3;
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        int position = static_cast<int>(target.size()) - static_cast<int>(exponent) + i;
+        uint8_t byte = static_cast<uint8_t>(mantissa >> (8 * (2 - i)));
+        if (position < 0)
+        {
+            if (byte != 0)
+            {
+                target.fill(0xff); // переполнение: цель больше 2^256
+                return target;
+            }
+            continue;
+        }
+        target[position] = byte;
+    }
+    return target;
+}
+
+uint32_t BlockHeader::compactFromTarget(const HashBytes& target)
+{
+    size_t first = 0;
+    while (first < target.size() && target[first] == 0)
+    {
+        ++first;
+    }
+    if (first == target.size())
+    {
+        return 0;
+    }
+    uint32_t exponent = static_cast<uint32_t>(target.size() - first);
+    uint32_t mantissa = 0;
+    for (size_t i = 0; i < 3; ++i)
+    {
+        mantissa <<= 8;
+        if (first + i < target.size())
+        {
+            mantissa |= target[first + i];
+        }
+    }
+    if (mantissa & 0x00800000)
+    {
+        mantissa >>= 8;
+        ++exponent;
+    }
+    return (exponent << 24) | mantissa;
+}
+
+uint32_t BlockHeader::compactFromDifficulty(int difficulty)
+{
+    return compactFromTarget(targetFromDifficulty(difficulty));
+}
+
+uint32_t BlockHeader::retargetCompact(uint32_t bits, int64_t actualTimespan, int64_t expectedTimespan, uint32_t powLimitBits)
+{
+    if (expectedTimespan <= 0)
+    {
+        return bits;
+    }
+    // Как в Bitcoin: за один пересчёт сложность меняется не более чем в 4 раза.
+    // Сравнение с expectedTimespan * 4 - без переполнения знакового умножения
+    if (actualTimespan < expectedTimespan / 4) actualTimespan = expectedTimespan / 4;
+    if (expectedTimespan <= INT64_MAX / 4 && actualTimespan > expectedTimespan * 4) actualTimespan = expectedTimespan * 4;
+    if (actualTimespan <= 0) actualTimespan = 1;
+
+    uint64_t mantissa = bits & 0x007fffff;
+    uint32_t exponent = bits >> 24;
+    // Сдвигаем мантиссу влево, чтобы деление не съело точность
+    while (mantissa != 0 && mantissa < (uint64_t(1) << 32) && exponent > 0)
+    {
+        mantissa <<= 8;
+        --exponent;
+    }
+    // Мантисса до 2^40, интервал до 2^63: произведение шире 64 бит,
+    // а частное не больше 4 * мантиссы и в uint64_t помещается
+    mantissa = mulDiv(mantissa, static_cast<uint64_t>(actualTimespan), static_cast<uint64_t>(expectedTimespan));
+    while (mantissa > 0x007fffff)
+    {
+        mantissa >>= 8;
+        ++exponent;
+    }
+    uint32_t result = (exponent << 24) | static_cast<uint32_t>(mantissa);
+    result = compactFromTarget(targetFromCompact(result)); // нормализация
+    if (!meetsTarget(targetFromCompact(result), targetFromCompact(powLimitBits)))
+    {
+        return powLimitBits;
+    }
+    if (result == 0)
+    {
+        return bits;
+    }
+    return result;
+}
+
+std::string BlockHeader::compactToString(uint32_t bits)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string hex = "0x";
+    for (int shift = 28; shift >= 0; shift -= 4)
+    {
+        hex += digits[(bits >> shift) & 0x0f];
+    }
+    return hex;
+}
+
+HeaderMidstate::HeaderMidstate(const BlockHeader& header)
+{
+    auto bytes = header.serialize();
+    SHA256_Init(&ctx);
+    SHA256_Update(&ctx, bytes.data(), BlockHeader::MIDSTATE_SIZE);
+    std::memcpy(tail.data(), bytes.data() + BlockHeader::MIDSTATE_SIZE, tail.size());
+    nonceHigh = static_cast<uint32_t>(header.nonce >> 32);
+
+    // После ровно двух блоков в ctx.h лежит сжатое состояние, буфер контекста пуст
+    for (int i = 0; i < 8; ++i)
+    {
+        midstateWords[i] = ctx.h[i];
+    }
+    uint8_t block[64] = {};
+    std::memcpy(block, tail.data(), tail.size());
+    block[tail.size()] = 0x80;
+    const uint64_t bitLength = BlockHeader::SIZE * 8;
+    for (int i = 0; i < 8; ++i)
+    {
+        block[63 - i] = static_cast<uint8_t>(bitLength >> (8 * i));
+    }
+    for (int i = 0; i < 16; ++i)
+    {
+        tailWords[i] = (uint32_t(block[4 * i]) << 24) | (uint32_t(block[4 * i + 1]) << 16)
+                       | (uint32_t(block[4 * i + 2]) << 8) | uint32_t(block[4 * i + 3]);
+    }
+}
+
+uint64_t HeaderMidstate::fullNonce(uint32_t nonceLow) const
+{
+    return (uint64_t(nonceHigh) << 32) | nonceLow;
+}
+
+HashBytes HeaderMidstate::hash(uint32_t nonceLow) const
+{
+    auto block = tail;
+    writeLE32(&block[BlockHeader::NONCE_OFFSET - BlockHeader::MIDSTATE_SIZE], nonceLow);
+    SHA256_CTX sha256 = ctx; // копия состояния вместо повторного хэширования первых 128 байт
+    HashBytes first;
+    HashBytes second;
+    SHA256_Update(&sha256, block.data(), block.size());
+    SHA256_Final(first.data(), &sha256);
+    SHA256(first.data(), first.size(), second.data());
+    return second;
+}
@@ -0,0 +1,70 @@
+#ifndef BLOCKHEADER_H
+#define BLOCKHEADER_H
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <openssl/sha.h>
+#include "Transaction.h"
+#include "Hash256.h"
+
+// Заголовок блока фиксированного размера: PoW и валидация хэшируют только его,
+// поэтому стоимость не зависит от числа транзакций.
+// Раскладка (little-endian):
+//  0 version | 4 index | 8 timestamp | 16 prevHash | 48 merkleRoot | 80 stateRoot | 112 bits |
+//  116 reserved (12 нулевых байт) | 128 nonce (64 бита)
+// Всё до nonce - ровно два блока SHA-256, поэтому midstate по-прежнему считается один раз
+// на шаблон, а на попытку хэшируется один блок хвоста.
+struct BlockHeader
+{
+    static constexpr uint32_t CURRENT_VERSION = 2;
+    static constexpr size_t SIZE = 136;
+    static constexpr size_t NONCE_OFFSET = 128;
+    static constexpr size_t MIDSTATE_SIZE = 128; // первые два блока SHA-256 не зависят от nonce
+
+    uint32_t version = CURRENT_VERSION;
+    uint32_t index = 0;
+    int64_t timestamp = 0;
+    HashBytes prevHash{};
+    HashBytes merkleRoot{};
+    HashBytes stateRoot{}; // корень StateTree после исполнения родительского блока
+    uint32_t bits = 0;  // цель PoW в компактном виде (как nBits в Bitcoin)
+    uint64_t nonce = 0;
+
+    std::array<uint8_t, SIZE> serialize() const;
+    static BlockHeader deserialize(const uint8_t* data); // ровно SIZE байт; std::runtime_error, если версия не CURRENT_VERSION
+    HashBytes hash() const; // SHA256(SHA256(header))
+
+    static HashBytes computeMerkleRoot(const std::vector<Transaction>& transactions);
+    static HashBytes sha256d(const uint8_t* data, size_t length);
+    static HashBytes targetFromDifficulty(int difficulty); // difficulty ведущих hex-нулей
+    static bool meetsTarget(const HashBytes& hash, const HashBytes& target);
+
+    // Компактная цель: старший байт - длина числа в байтах, младшие 3 - мантисса.
+    // Хэш сравнивается с целью как 256-битное big-endian число.
+    static HashBytes targetFromCompact(uint32_t bits);
+    static uint32_t compactFromTarget(const HashBytes& target);
+    static uint32_t compactFromDifficulty(int difficulty);
+    // Цель * actualTimespan / expectedTimespan, без выхода за powLimitBits
+    static uint32_t retargetCompact(uint32_t bits, int64_t actualTimespan, int64_t expectedTimespan, uint32_t powLimitBits);
+    static std::string compactToString(uint32_t bits);
+};
+
+// Состояние SHA-256 после постоянных 128 байт заголовка + неизменная часть хвоста.
+// На каждую попытку хэшируется только 8-байтовый хвост с nonce и второй SHA-256.
+// Перебираются младшие 32 бита nonce; старшие (extra-nonce) зафиксированы в шаблоне.
+struct HeaderMidstate
+{
+    SHA256_CTX ctx;
+    std::array<uint8_t, BlockHeader::SIZE - BlockHeader::MIDSTATE_SIZE> tail;
+    uint32_t midstateWords[8]; // то же состояние словами - для SIMD и SHA-NI ядер
+    uint32_t tailWords[16];    // последний блок SHA-256 с паддингом, big-endian слова
+    uint32_t nonceHigh;        // extra-nonce шаблона
+
+    explicit HeaderMidstate(const BlockHeader& header);
+    HashBytes hash(uint32_t nonceLow) const;
+    uint64_t fullNonce(uint32_t nonceLow) const;
+};
+
+#endif // BLOCKHEADER_H
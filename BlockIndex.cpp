@@ -0,0 +1,108 @@
+#include "BlockIndex.h"
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+BlockIndex::BlockIndex() : slots(INITIAL_CAPACITY, 0) {}
+
+void BlockIndex::add(const Block& block)
+{
+    if (block.getIndex() < 0 || static_cast<size_t>(block.getIndex()) != byHeight.size())
+    {
+        throw std::invalid_argument("Block index expects height " + std::to_string(byHeight.size()) +
+                                    ", got " + std::to_string(block.getIndex()));
+    }
+    // Загрузка не выше 1/2: цепочки пробирования остаются короткими
+    if (2 * (byHeight.size() + 1) > slots.size())
+    {
+        grow();
+    }
+    byHeight.push_back({block.getHash(), block.getPrevHash(), block.getIndex(), block.getTimestamp(),
+                        block.getBits(), &block});
+    insertSlot(block.getHash(), byHeight.size() - 1);
+}
+
+const BlockMeta* BlockIndex::findByHash(const Hash256& hash) const
+{
+    const size_t mask = slots.size() - 1;
+    for (size_t slot = std::hash<Hash256>()(hash) & mask; slots[slot] != 0; slot = (slot + 1) & mask)
+    {
+        const BlockMeta& meta = byHeight[slots[slot] - 1];
+        if (meta.hash == hash)
+        {
+            return &meta;
+        }
+    }
+    return nullptr;
+}
+
+const BlockMeta* BlockIndex::findByHeight(size_t height) const
+{
+    return height < byHeight.size() ? &byHeight[height] : nullptr;
+}
+
+size_t BlockIndex::size() const
+{
+    return byHeight.size();
+}
+
+void BlockIndex::truncate(size_t height)
+{
+    while (byHeight.size() > height)
+    {
+        eraseSlot(byHeight.back().hash);
+        byHeight.pop_back();
+    }
+}
+
+void BlockIndex::clear()
+{
+    byHeight.clear();
+    slots.assign(INITIAL_CAPACITY, 0);
+}
+
+void BlockIndex::insertSlot(const Hash256& hash, size_t height)
+{
+    const size_t mask = slots.size() - 1;
+    size_t slot = std::hash<Hash256>()(hash) & mask;
+    while (slots[slot] != 0)
+    {
+        slot = (slot + 1) & mask;
+    }
+    slots[slot] = static_cast<uint32_t>(height + 1);
+}
+
+void BlockIndex::eraseSlot(const Hash256& hash)
+{
+    const size_t mask = slots.size() - 1;
+    size_t slot = std::hash<Hash256>()(hash) & mask;
+    while (slots[slot] != 0 && byHeight[slots[slot] - 1].hash != hash)
+    {
+        slot = (slot + 1) & mask;
+    }
+    if (slots[slot] == 0)
+    {
+        return;
+    }
+    // Удаление со сдвигом назад: цепочки пробирования остаются без дыр, надгробия не нужны
+    for (size_t next = (slot + 1) & mask; slots[next] != 0; next = (next + 1) & mask)
+    {
+        const size_t home = std::hash<Hash256>()(byHeight[slots[next] - 1].hash) & mask;
+        const bool stays = slot <= next ? (slot < home && home <= next) : (slot < home || home <= next);
+        if (!stays)
+        {
+            slots[slot] = slots[next];
+            slot = next;
+        }
+    }
+    slots[slot] = 0;
+}
+
+void BlockIndex::grow()
+{
+    slots.assign(slots.size() * 2, 0);
+    for (size_t height = 0; height < byHeight.size(); ++height)
+    {
+        insertSlot(byHeight[height].hash, height);
+    }
+}
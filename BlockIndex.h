@@ -0,0 +1,42 @@
+#ifndef BLOCKINDEX_H
+#define BLOCKINDEX_H
+#include <cstdint>
+#include <vector>
+#include "Block.h"
+#include "Hash256.h"
+
+// Метаданные блока в индексе; block указывает на блок в Blockchain::chain
+struct BlockMeta
+{
+    Hash256 hash;
+    Hash256 prevHash;
+    int height;
+    long long timestamp;
+    uint32_t bits;
+    const Block* block;
+};
+
+// Индекс блоков цепочки: вектор по высоте + хэш-таблица с открытой адресацией
+// (линейное пробирование) хэш -> высота. Поиск за O(1) независимо от длины цепочки.
+// Синхронизация - на вызывающем (Blockchain держит chainMutex).
+class BlockIndex
+{
+public:
+    BlockIndex();
+    void add(const Block& block); // высота блока должна быть равна size()
+    const BlockMeta* findByHash(const Hash256& hash) const;
+    const BlockMeta* findByHeight(size_t height) const;
+    size_t size() const;
+    void truncate(size_t height); // убирает блоки >= height (откат), O(числа убранных)
+    void clear();
+
+private:
+    static constexpr size_t INITIAL_CAPACITY = 1024; // степень двойки
+    std::vector<BlockMeta> byHeight;
+    std::vector<uint32_t> slots; // высота + 1, 0 - пустой слот
+    void insertSlot(const Hash256& hash, size_t height);
+    void eraseSlot(const Hash256& hash);
+    void grow();
+};
+
+#endif // BLOCKINDEX_H
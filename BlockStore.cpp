@@ -0,0 +1,710 @@
+#include "BlockStore.h"
+#include "Logger.h"
+#include "Crc32.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint32_t RECORD_MAGIC = 0xB10CB10D; // заголовок версии 2 (со stateRoot)
+constexpr uint32_t LEGACY_RECORD_MAGIC = 0xB10CB10C; // 92-байтовый заголовок без stateRoot
+constexpr size_t RECORD_HEADER_SIZE = 12; // magic | длина payload | CRC32 payload
+constexpr size_t PAYLOAD_HASH_OFFSET = BlockHeader::SIZE;
+constexpr size_t PAYLOAD_MIN_SIZE = BlockHeader::SIZE + Hash256::SIZE + 4;
+constexpr uint64_t INDEX_MAGIC = 0x33305844494b4c42ull; // "BLKIDX03": записи с заголовком версии 2
+// "BKHASH02": слоты по std::hash<Hash256> от всех слов хэша. Таблица с другой magic
+// (построенная прежней хэш-функцией) не читается, а перестраивается по индексу
+constexpr uint64_t HASH_TABLE_MAGIC = 0x3230485341484b42ull;
+constexpr uint64_t INITIAL_INDEX_CAPACITY = 1024;
+constexpr uint64_t INITIAL_HASH_CAPACITY = 2048;
+
+void appendLE32(std::vector<uint8_t>& out, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+uint32_t readLE32(const uint8_t* in)
+{
+    return uint32_t(in[0]) | (uint32_t(in[1]) << 8) | (uint32_t(in[2]) << 16) | (uint32_t(in[3]) << 24);
+}
+
+std::runtime_error systemError(const std::string& what)
+{
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+void writeAll(int fd, const uint8_t* data, size_t length, uint64_t offset)
+{
+    while (length > 0)
+    {
+        ssize_t written = ::pwrite(fd, data, length, static_cast<off_t>(offset));
+        if (written < 0)
+        {
+            if (errno == EINTR) continue;
+            throw systemError("Block store write failed");
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+}
+
+bool readAll(int fd, uint8_t* data, size_t length, uint64_t offset)
+{
+    while (length > 0)
+    {
+        ssize_t got = ::pread(fd, data, length, static_cast<off_t>(offset));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        data += got;
+        length -= static_cast<size_t>(got);
+        offset += static_cast<uint64_t>(got);
+    }
+    return true;
+}
+
+uint8_t* mapFile(int fd, size_t size)
+{
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        throw systemError("Failed to resize block store index");
+    }
+    void* map = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        throw systemError("Failed to map block store index");
+    }
+    return static_cast<uint8_t*>(map);
+}
+
+uint64_t fileSize(int fd)
+{
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        throw systemError("Failed to stat block store file");
+    }
+    return static_cast<uint64_t>(st.st_size);
+}
+
+}
+
+BlockStore::BlockStore(const std::string& directory) : directory(directory)
+{
+    std::filesystem::create_directories(directory);
+    openSegments();
+
+    indexFd = ::open((directory + "/index.dat").c_str(), O_RDWR | O_CREAT, 0644);
+    if (indexFd < 0)
+    {
+        throw systemError("Failed to open block index in " + directory);
+    }
+    IndexHeader stored{};
+    bool valid = fileSize(indexFd) >= sizeof(IndexHeader)
+                 && readAll(indexFd, reinterpret_cast<uint8_t*>(&stored), sizeof(stored), 0)
+                 && stored.magic == INDEX_MAGIC && stored.capacity > 0
+                 && fileSize(indexFd) >= sizeof(IndexHeader) + stored.capacity * sizeof(IndexEntry);
+    mapIndex(valid ? stored.capacity : INITIAL_INDEX_CAPACITY);
+    if (!valid)
+    {
+        // Нет индекса или он повреждён: восстановление перечитает сегменты с начала
+        indexHeader()->magic = INDEX_MAGIC;
+        indexHeader()->count = 0;
+        indexHeader()->prunedHeight = 0;
+    }
+
+    hashTableFd = ::open((directory + "/hashindex.dat").c_str(), O_RDWR | O_CREAT, 0644);
+    if (hashTableFd < 0)
+    {
+        throw systemError("Failed to open block hash index in " + directory);
+    }
+    HashTableHeader storedTable{};
+    bool tableValid = fileSize(hashTableFd) >= sizeof(HashTableHeader)
+                      && readAll(hashTableFd, reinterpret_cast<uint8_t*>(&storedTable), sizeof(storedTable), 0)
+                      && storedTable.magic == HASH_TABLE_MAGIC && storedTable.capacity > 0
+                      && (storedTable.capacity & (storedTable.capacity - 1)) == 0
+                      && fileSize(hashTableFd) >= sizeof(HashTableHeader) + storedTable.capacity * sizeof(uint32_t);
+    if (tableValid)
+    {
+        mapHashTable(storedTable.capacity);
+    }
+    else
+    {
+        rebuildHashTable(INITIAL_HASH_CAPACITY);
+    }
+
+    recover();
+    Logger::getInstance().log("Block store opened in " + directory + " with " + std::to_string(size()) +
+                              " blocks in " + std::to_string(segmentFds.size()) + " segments");
+}
+
+BlockStore::~BlockStore()
+{
+    try
+    {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        syncLocked();
+    }
+    catch (const std::exception& e)
+    {
+        Logger::getInstance().log("Error while closing block store: " + std::string(e.what()));
+    }
+    if (indexMap) ::munmap(indexMap, indexMapSize);
+    if (hashTableMap) ::munmap(hashTableMap, hashTableMapSize);
+    if (indexFd >= 0) ::close(indexFd);
+    if (hashTableFd >= 0) ::close(hashTableFd);
+    for (int fd : segmentFds)
+    {
+        if (fd >= 0) ::close(fd);
+    }
+}
+
+uint64_t BlockStore::size() const
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    return indexHeader()->count;
+}
+
+void BlockStore::append(const Block& block)
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    const uint64_t height = indexHeader()->count;
+    if (block.getIndex() < 0 || static_cast<uint64_t>(block.getIndex()) != height)
+    {
+        throw std::invalid_argument("Block store is append-only: expected height " + std::to_string(height) +
+                                    ", got " + std::to_string(block.getIndex()));
+    }
+
+    std::vector<uint8_t> record(RECORD_HEADER_SIZE);
+    auto header = block.getHeader().serialize();
+    record.insert(record.end(), header.begin(), header.end());
+    record.insert(record.end(), block.getHash().data(), block.getHash().data() + Hash256::SIZE);
+    appendLE32(record, static_cast<uint32_t>(block.getTransactions().size()));
+    for (const auto& tx : block.getTransactions())
+    {
+        const std::vector<uint8_t>& encoded = tx.serialize();
+        appendLE32(record, static_cast<uint32_t>(encoded.size()));
+        record.insert(record.end(), encoded.begin(), encoded.end());
+    }
+    const uint32_t payloadLength = static_cast<uint32_t>(record.size() - RECORD_HEADER_SIZE);
+    const uint32_t checksum = crc32(record.data() + RECORD_HEADER_SIZE, payloadLength);
+    for (int i = 0; i < 4; ++i)
+    {
+        record[i] = static_cast<uint8_t>(RECORD_MAGIC >> (8 * i));
+        record[4 + i] = static_cast<uint8_t>(payloadLength >> (8 * i));
+        record[8 + i] = static_cast<uint8_t>(checksum >> (8 * i));
+    }
+
+    uint32_t segment = static_cast<uint32_t>(segmentFds.size() - 1);
+    if (segmentSizes[segment] > 0 && segmentSizes[segment] + record.size() > SEGMENT_MAX_BYTES)
+    {
+        // Закрываемый сегмент сбрасывается сразу, дальше пишем только в новый
+        if (::fdatasync(segmentFds[segment]) != 0)
+        {
+            throw systemError("Failed to sync block segment");
+        }
+        openSegment(++segment);
+        Logger::getInstance().log("Block store rolled over to segment " + segmentPath(segment));
+    }
+    const uint64_t offset = segmentSizes[segment];
+    writeAll(segmentFds[segment], record.data(), record.size(), offset);
+    segmentSizes[segment] += record.size();
+    addEntry(block.getHash(), header.data(), segment, offset, payloadLength);
+
+    if (++unsyncedBlocks >= SYNC_BATCH)
+    {
+        syncLocked();
+    }
+}
+
+BlockStore::StoredBlock BlockStore::read(uint64_t height) const
+{
+    std::vector<uint8_t> payload;
+    {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        if (height >= indexHeader()->count)
+        {
+            throw std::out_of_range("No stored block at height " + std::to_string(height));
+        }
+        const IndexEntry& entry = entries()[height];
+        if (segmentFds[entry.segment] < 0)
+        {
+            throw std::runtime_error("Body of block at height " + std::to_string(height) + " was pruned");
+        }
+        if (!readRecord(entry.segment, entry.offset, payload) || payload.size() < PAYLOAD_MIN_SIZE)
+        {
+            throw std::runtime_error("Corrupted block record at height " + std::to_string(height));
+        }
+    }
+
+    StoredBlock stored;
+    stored.header = BlockHeader::deserialize(payload.data());
+    HashBytes hash;
+    std::memcpy(hash.data(), payload.data() + PAYLOAD_HASH_OFFSET, hash.size());
+    stored.hash = Hash256(hash);
+    size_t position = PAYLOAD_HASH_OFFSET + Hash256::SIZE;
+    const uint32_t txCount = readLE32(payload.data() + position);
+    position += 4;
+    stored.transactions.reserve(txCount);
+    for (uint32_t i = 0; i < txCount; ++i)
+    {
+        if (payload.size() - position < 4)
+        {
+            throw std::runtime_error("Truncated transaction list at height " + std::to_string(height));
+        }
+        const uint32_t length = readLE32(payload.data() + position);
+        position += 4;
+        if (payload.size() - position < length)
+        {
+            throw std::runtime_error("Truncated transaction at height " + std::to_string(height));
+        }
+        stored.transactions.push_back(Transaction::deserialize(payload.data() + position, length));
+        position += length;
+    }
+    return stored;
+}
+
+BlockHeader BlockStore::readHeader(uint64_t height) const
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    if (height >= indexHeader()->count)
+    {
+        throw std::out_of_range("No stored block at height " + std::to_string(height));
+    }
+    return BlockHeader::deserialize(entries()[height].header);
+}
+
+bool BlockStore::hasBody(uint64_t height) const
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    return height < indexHeader()->count && segmentFds[entries()[height].segment] >= 0;
+}
+
+uint64_t BlockStore::pruneBelow(uint64_t height)
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    const uint64_t count = indexHeader()->count;
+    if (count == 0)
+    {
+        return 0;
+    }
+    height = std::min(height, count - 1); // сегмент с вершиной цепочки остаётся
+    const uint32_t keepFrom = entries()[height].segment;
+    if (keepFrom == 0 || segmentFds[keepFrom - 1] < 0)
+    {
+        return indexHeader()->prunedHeight; // удалять нечего: сегменты до keepFrom уже удалены
+    }
+    uint64_t first = height;
+    while (first > 0 && entries()[first - 1].segment == keepFrom)
+    {
+        --first;
+    }
+    // Сначала на диск уходит новая граница, потом удаляются файлы: после сбоя в середине
+    // лишние сегменты просто останутся
+    indexHeader()->prunedHeight = first;
+    syncLocked();
+    uint32_t removed = 0;
+    for (uint32_t segment = 0; segment < keepFrom; ++segment)
+    {
+        if (segmentFds[segment] < 0)
+        {
+            continue;
+        }
+        ::close(segmentFds[segment]);
+        segmentFds[segment] = -1;
+        segmentSizes[segment] = 0;
+        std::filesystem::remove(segmentPath(segment));
+        ++removed;
+    }
+    Logger::getInstance().log("Block store pruned " + std::to_string(removed) + " segments, bodies kept from height " +
+                              std::to_string(first));
+    return first;
+}
+
+void BlockStore::truncate(uint64_t height)
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    const uint64_t count = indexHeader()->count;
+    if (height >= count)
+    {
+        return;
+    }
+    if (height < indexHeader()->prunedHeight)
+    {
+        throw std::runtime_error("Cannot truncate block store to height " + std::to_string(height) +
+                                 ": bodies below " + std::to_string(indexHeader()->prunedHeight) + " are pruned");
+    }
+    const uint32_t segment = entries()[height].segment;
+    const uint64_t offset = entries()[height].offset;
+    if (::ftruncate(segmentFds[segment], static_cast<off_t>(offset)) != 0 || ::fdatasync(segmentFds[segment]) != 0)
+    {
+        throw systemError("Failed to truncate block segment");
+    }
+    segmentSizes[segment] = offset;
+    while (segmentFds.size() > size_t(segment) + 1)
+    {
+        ::close(segmentFds.back());
+        std::filesystem::remove(segmentPath(segmentFds.size() - 1));
+        segmentFds.pop_back();
+        segmentSizes.pop_back();
+    }
+    for (uint64_t h = count; h-- > height;)
+    {
+        HashBytes hash;
+        std::memcpy(hash.data(), entries()[h].hash, hash.size());
+        eraseHash(Hash256(hash));
+    }
+    indexHeader()->count = height;
+    syncLocked();
+    Logger::getInstance().log("Block store truncated from " + std::to_string(count) + " to " + std::to_string(height) + " blocks");
+}
+
+Hash256 BlockStore::hashAt(uint64_t height) const
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    if (height >= indexHeader()->count)
+    {
+        throw std::out_of_range("No stored block at height " + std::to_string(height));
+    }
+    HashBytes hash;
+    std::memcpy(hash.data(), entries()[height].hash, hash.size());
+    return Hash256(hash);
+}
+
+bool BlockStore::findHeight(const Hash256& hash, uint64_t& height) const
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    return lookupHash(hash, height);
+}
+
+void BlockStore::sync()
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    syncLocked();
+}
+
+BlockStore::IndexHeader* BlockStore::indexHeader() const
+{
+    return reinterpret_cast<IndexHeader*>(indexMap);
+}
+
+BlockStore::IndexEntry* BlockStore::entries() const
+{
+    return reinterpret_cast<IndexEntry*>(indexMap + sizeof(IndexHeader));
+}
+
+BlockStore::HashTableHeader* BlockStore::hashTableHeader() const
+{
+    return reinterpret_cast<HashTableHeader*>(hashTableMap);
+}
+
+uint32_t* BlockStore::slots() const
+{
+    return reinterpret_cast<uint32_t*>(hashTableMap + sizeof(HashTableHeader));
+}
+
+std::string BlockStore::segmentPath(size_t segment) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "/blk%05zu.dat", segment);
+    return directory + name;
+}
+
+void BlockStore::openSegments()
+{
+    // После pruneBelow() первые сегменты удалены: их слоты остаются с fd -1
+    size_t last = 0;
+    for (const auto& file : std::filesystem::directory_iterator(directory))
+    {
+        const std::string name = file.path().filename().string();
+        unsigned segment = 0;
+        int consumed = 0;
+        if (std::sscanf(name.c_str(), "blk%5u.dat%n", &segment, &consumed) == 1 && static_cast<size_t>(consumed) == name.size())
+        {
+            last = std::max(last, static_cast<size_t>(segment));
+        }
+    }
+    for (size_t segment = 0; segment <= last; ++segment)
+    {
+        if (segment == last || std::filesystem::exists(segmentPath(segment)))
+        {
+            openSegment(segment);
+        }
+    }
+}
+
+void BlockStore::openSegment(size_t segment)
+{
+    int fd = ::open(segmentPath(segment).c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        throw systemError("Failed to open block segment " + segmentPath(segment));
+    }
+    if (segmentFds.size() <= segment)
+    {
+        segmentFds.resize(segment + 1, -1);
+        segmentSizes.resize(segment + 1, 0);
+    }
+    segmentFds[segment] = fd;
+    segmentSizes[segment] = fileSize(fd);
+}
+
+void BlockStore::mapIndex(uint64_t capacity)
+{
+    if (indexMap)
+    {
+        ::munmap(indexMap, indexMapSize);
+        indexMap = nullptr;
+    }
+    indexMapSize = sizeof(IndexHeader) + capacity * sizeof(IndexEntry);
+    indexMap = mapFile(indexFd, indexMapSize);
+    indexHeader()->capacity = capacity;
+}
+
+void BlockStore::mapHashTable(uint64_t capacity)
+{
+    if (hashTableMap)
+    {
+        ::munmap(hashTableMap, hashTableMapSize);
+        hashTableMap = nullptr;
+    }
+    hashTableMapSize = sizeof(HashTableHeader) + capacity * sizeof(uint32_t);
+    hashTableMap = mapFile(hashTableFd, hashTableMapSize);
+}
+
+void BlockStore::rebuildHashTable(uint64_t capacity)
+{
+    const uint64_t count = indexMap ? indexHeader()->count : 0;
+    while (capacity < 2 * (count + 1))
+    {
+        capacity *= 2;
+    }
+    mapHashTable(capacity);
+    std::memset(slots(), 0, capacity * sizeof(uint32_t));
+    hashTableHeader()->magic = HASH_TABLE_MAGIC;
+    hashTableHeader()->capacity = capacity;
+    hashTableHeader()->count = 0;
+    for (uint64_t height = 0; height < count; ++height)
+    {
+        HashBytes hash;
+        std::memcpy(hash.data(), entries()[height].hash, hash.size());
+        insertHash(Hash256(hash), height);
+    }
+}
+
+void BlockStore::insertHash(const Hash256& hash, uint64_t height)
+{
+    const uint64_t mask = hashTableHeader()->capacity - 1;
+    uint64_t slot = std::hash<Hash256>()(hash) & mask;
+    while (slots()[slot] != 0)
+    {
+        slot = (slot + 1) & mask;
+    }
+    slots()[slot] = static_cast<uint32_t>(height + 1);
+    ++hashTableHeader()->count;
+}
+
+void BlockStore::eraseHash(const Hash256& hash)
+{
+    const uint64_t mask = hashTableHeader()->capacity - 1;
+    auto hashAtSlot = [this](uint64_t slot) {
+        HashBytes bytes;
+        std::memcpy(bytes.data(), entries()[slots()[slot] - 1].hash, bytes.size());
+        return Hash256(bytes);
+    };
+    uint64_t slot = std::hash<Hash256>()(hash) & mask;
+    while (slots()[slot] != 0 && hashAtSlot(slot) != hash)
+    {
+        slot = (slot + 1) & mask;
+    }
+    if (slots()[slot] == 0)
+    {
+        return;
+    }
+    // Удаление со сдвигом назад, как в BlockIndex
+    for (uint64_t next = (slot + 1) & mask; slots()[next] != 0; next = (next + 1) & mask)
+    {
+        const uint64_t home = std::hash<Hash256>()(hashAtSlot(next)) & mask;
+        const bool stays = slot <= next ? (slot < home && home <= next) : (slot < home || home <= next);
+        if (!stays)
+        {
+            slots()[slot] = slots()[next];
+            slot = next;
+        }
+    }
+    slots()[slot] = 0;
+    --hashTableHeader()->count;
+}
+
+bool BlockStore::lookupHash(const Hash256& hash, uint64_t& height) const
+{
+    const uint64_t mask = hashTableHeader()->capacity - 1;
+    const uint64_t count = indexHeader()->count;
+    for (uint64_t slot = std::hash<Hash256>()(hash) & mask; slots()[slot] != 0; slot = (slot + 1) & mask)
+    {
+        const uint64_t candidate = slots()[slot] - 1;
+        if (candidate < count && std::memcmp(entries()[candidate].hash, hash.data(), Hash256::SIZE) == 0)
+        {
+            height = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void BlockStore::addEntry(const Hash256& hash, const uint8_t* header, uint32_t segment, uint64_t offset, uint32_t length)
+{
+    const uint64_t height = indexHeader()->count;
+    if (height == indexHeader()->capacity)
+    {
+        mapIndex(indexHeader()->capacity * 2);
+    }
+    IndexEntry& entry = entries()[height];
+    std::memcpy(entry.hash, hash.data(), Hash256::SIZE);
+    entry.segment = segment;
+    entry.length = length;
+    entry.offset = offset;
+    std::memcpy(entry.header, header, BlockHeader::SIZE);
+    indexHeader()->count = height + 1; // запись видна только после заполнения
+
+    if (2 * (hashTableHeader()->count + 1) > hashTableHeader()->capacity)
+    {
+        rebuildHashTable(hashTableHeader()->capacity * 2);
+    }
+    else
+    {
+        insertHash(hash, height);
+    }
+}
+
+void BlockStore::recover()
+{
+    // Индекс мог уйти на диск раньше данных: отбрасываем записи индекса с конца,
+    // пока запись в сегменте не совпадёт. При чистом завершении это одна проверка.
+    // Ниже prunedHeight тел нет, сверять там нечего.
+    uint64_t count = std::min(indexHeader()->count, indexHeader()->capacity);
+    const uint64_t indexed = count;
+    while (count > indexHeader()->prunedHeight && !recordMatches(entries()[count - 1], count - 1))
+    {
+        --count;
+    }
+    indexHeader()->count = count;
+    if (hashTableHeader()->count != count)
+    {
+        rebuildHashTable(hashTableHeader()->capacity);
+    }
+
+    // Доиндексируем записи, дописанные после последнего сброса индекса
+    uint32_t segment = 0;
+    uint64_t offset = 0;
+    if (count > 0)
+    {
+        const IndexEntry& last = entries()[count - 1];
+        segment = last.segment;
+        offset = last.offset + RECORD_HEADER_SIZE + last.length;
+    }
+    std::vector<uint8_t> payload;
+    for (; segment < segmentFds.size(); ++segment, offset = 0)
+    {
+        if (segmentFds[segment] < 0)
+        {
+            throw std::runtime_error("Block store in " + directory + " has pruned segments and cannot rebuild its index");
+        }
+        while (offset < segmentSizes[segment] && readRecord(segment, offset, payload)
+               && payload.size() >= PAYLOAD_MIN_SIZE && readLE32(payload.data() + 4) == indexHeader()->count)
+        {
+            HashBytes hash;
+            std::memcpy(hash.data(), payload.data() + PAYLOAD_HASH_OFFSET, hash.size());
+            addEntry(Hash256(hash), payload.data(), segment, offset, static_cast<uint32_t>(payload.size()));
+            offset += RECORD_HEADER_SIZE + payload.size();
+        }
+        if (offset < segmentSizes[segment])
+        {
+            uint8_t magic[4];
+            if (readAll(segmentFds[segment], magic, sizeof(magic), offset) && readLE32(magic) == LEGACY_RECORD_MAGIC)
+            {
+                // Не обрезаем: это целая цепочка старого формата, а не оборванный хвост
+                throw std::runtime_error("Block store in " + directory + " uses the old header format; remove it to resync");
+            }
+            // Оборванная запись: обрезаем сегмент, более поздние сегменты не могут быть целыми
+            Logger::getInstance().log("Block store: truncating torn tail of " + segmentPath(segment) + " at offset " +
+                                      std::to_string(offset) + " (was " + std::to_string(segmentSizes[segment]) + ")");
+            if (::ftruncate(segmentFds[segment], static_cast<off_t>(offset)) != 0)
+            {
+                throw systemError("Failed to truncate block segment");
+            }
+            segmentSizes[segment] = offset;
+            while (segmentFds.size() > segment + 1)
+            {
+                ::close(segmentFds.back());
+                std::filesystem::remove(segmentPath(segmentFds.size() - 1));
+                segmentFds.pop_back();
+                segmentSizes.pop_back();
+            }
+            break;
+        }
+    }
+    if (indexHeader()->count != indexed)
+    {
+        Logger::getInstance().log("Block store recovered: index had " + std::to_string(indexed) + " blocks, now " +
+                                  std::to_string(indexHeader()->count));
+        syncLocked();
+    }
+}
+
+bool BlockStore::readRecord(uint32_t segment, uint64_t offset, std::vector<uint8_t>& payload) const
+{
+    if (segment >= segmentFds.size() || segmentFds[segment] < 0 || segmentSizes[segment] < offset + RECORD_HEADER_SIZE)
+    {
+        return false;
+    }
+    uint8_t header[RECORD_HEADER_SIZE];
+    if (!readAll(segmentFds[segment], header, sizeof(header), offset) || readLE32(header) != RECORD_MAGIC)
+    {
+        return false;
+    }
+    const uint32_t length = readLE32(header + 4);
+    if (segmentSizes[segment] - offset - RECORD_HEADER_SIZE < length)
+    {
+        return false;
+    }
+    payload.resize(length);
+    return readAll(segmentFds[segment], payload.data(), length, offset + RECORD_HEADER_SIZE)
+           && crc32(payload.data(), length) == readLE32(header + 8);
+}
+
+bool BlockStore::recordMatches(const IndexEntry& entry, uint64_t height) const
+{
+    std::vector<uint8_t> payload;
+    return readRecord(entry.segment, entry.offset, payload) && payload.size() == entry.length
+           && payload.size() >= PAYLOAD_MIN_SIZE && readLE32(payload.data() + 4) == height
+           && std::memcmp(payload.data() + PAYLOAD_HASH_OFFSET, entry.hash, Hash256::SIZE) == 0;
+}
+
+void BlockStore::syncLocked()
+{
+    if (!segmentFds.empty() && ::fdatasync(segmentFds.back()) != 0)
+    {
+        throw systemError("Failed to sync block segment");
+    }
+    if (indexMap && ::msync(indexMap, indexMapSize, MS_SYNC) != 0)
+    {
+        throw systemError("Failed to sync block index");
+    }
+    if (hashTableMap && ::msync(hashTableMap, hashTableMapSize, MS_SYNC) != 0)
+    {
+        throw systemError("Failed to sync block hash index");
+    }
+    unsyncedBlocks = 0;
+}
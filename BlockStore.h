@@ -0,0 +1,120 @@
+#ifndef BLOCKSTORE_H
+#define BLOCKSTORE_H
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Block.h"
+#include "BlockHeader.h"
+#include "Hash256.h"
+#include "Transaction.h"
+
+// Дисковое хранилище цепочки, только дозапись.
+//
+// Блоки лежат в сегментах blkNNNNN.dat (новый сегмент после SEGMENT_MAX_BYTES),
+// каждая запись: magic | длина | CRC32 | payload, payload = заголовок (BlockHeader::SIZE байт) |
+// хэш | число транзакций | транзакции с префиксом длины.
+//
+// index.dat отображается в память: по высоте - хэш, сегмент, смещение и длина записи.
+// hashindex.dat - отображённая хэш-таблица (открытая адресация) хэш -> высота.
+// При старте индекс просто отображается; проверяется только хвост: записи, которые
+// не успели попасть в индекс, доиндексируются, а оборванная запись обрезается.
+//
+// fsync делается пачками по SYNC_BATCH блоков (и в sync()/деструкторе), поэтому после
+// сбоя могут пропасть последние несколько блоков, но не целостность хранилища.
+//
+// Заголовки всех блоков дублируются в index.dat, поэтому тела старых блоков можно удалить
+// (pruneBelow) целыми сегментами: readHeader() работает для любой высоты, read() - только
+// пока hasBody(). Удалённые сегменты не восстанавливаются, текущий сегмент не удаляется.
+class BlockStore
+{
+public:
+    static constexpr uint64_t SEGMENT_MAX_BYTES = 64ull << 20;
+    static constexpr uint32_t SYNC_BATCH = 8;
+
+    struct StoredBlock
+    {
+        BlockHeader header;
+        Hash256 hash;
+        std::vector<Transaction> transactions;
+    };
+
+    explicit BlockStore(const std::string& directory);
+    ~BlockStore();
+    BlockStore(const BlockStore&) = delete;
+    BlockStore& operator=(const BlockStore&) = delete;
+
+    uint64_t size() const; // число сохранённых блоков (высота следующего)
+    void append(const Block& block); // высота блока должна быть равна size()
+    StoredBlock read(uint64_t height) const; // std::runtime_error, если тело удалено
+    BlockHeader readHeader(uint64_t height) const; // из индекса, без чтения сегмента
+    Hash256 hashAt(uint64_t height) const;
+    bool hasBody(uint64_t height) const;
+    // Удаляет сегменты, все блоки которых ниже height; возвращает нижнюю высоту, с которой тела есть
+    uint64_t pruneBelow(uint64_t height);
+    // Убирает блоки >= height (откат): сначала обрезаются сегменты, потом индекс, так что после
+    // сбоя recover() не вернёт убранные блоки. Ниже удалённых тел обрезать нельзя.
+    void truncate(uint64_t height);
+    bool findHeight(const Hash256& hash, uint64_t& height) const;
+    void sync(); // сбрасывает на диск сегмент и индексы
+
+private:
+    struct IndexEntry
+    {
+        uint8_t hash[32];
+        uint32_t segment;
+        uint32_t length; // длина payload
+        uint64_t offset; // смещение записи в сегменте
+        uint8_t header[BlockHeader::SIZE];
+    };
+    struct IndexHeader
+    {
+        uint64_t magic;
+        uint64_t count;
+        uint64_t capacity;
+        uint64_t prunedHeight; // тела блоков ниже этой высоты удалены
+    };
+    struct HashTableHeader
+    {
+        uint64_t magic;
+        uint64_t capacity; // степень двойки
+        uint64_t count;
+        uint64_t reserved;
+    };
+
+    std::string directory;
+    mutable std::mutex storeMutex;
+    std::vector<int> segmentFds; // -1 - сегмент удалён pruneBelow()
+    std::vector<uint64_t> segmentSizes;
+
+    int indexFd = -1;
+    uint8_t* indexMap = nullptr;
+    size_t indexMapSize = 0;
+    int hashTableFd = -1;
+    uint8_t* hashTableMap = nullptr;
+    size_t hashTableMapSize = 0;
+    uint32_t unsyncedBlocks = 0;
+
+    IndexHeader* indexHeader() const;
+    IndexEntry* entries() const;
+    HashTableHeader* hashTableHeader() const;
+    uint32_t* slots() const; // высота + 1, 0 - пустой слот
+
+    std::string segmentPath(size_t segment) const;
+    void openSegments();
+    void openSegment(size_t segment);
+    void mapIndex(uint64_t capacity);
+    void mapHashTable(uint64_t capacity);
+    void rebuildHashTable(uint64_t capacity);
+    void insertHash(const Hash256& hash, uint64_t height);
+    void eraseHash(const Hash256& hash);
+    bool lookupHash(const Hash256& hash, uint64_t& height) const;
+    void addEntry(const Hash256& hash, const uint8_t* header, uint32_t segment, uint64_t offset, uint32_t length);
+
+    void recover();
+    bool readRecord(uint32_t segment, uint64_t offset, std::vector<uint8_t>& payload) const;
+    bool recordMatches(const IndexEntry& entry, uint64_t height) const;
+    void syncLocked();
+};
+
+#endif // BLOCKSTORE_H
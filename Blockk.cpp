@@ -1,8 +1,126 @@
 #include <string>
 #include "Block.h"
+#include "Logger.h"
 
 
 // Block.cpp
-std::string Block::getPrevHash() const {
+const Hash256& Block::getPrevHash() const {
     return prevHash;
 }
+
+BlockHeader Block::getHeader() const
+{
+    BlockHeader header;
+    header.index = static_cast<uint32_t>(index);
+    header.timestamp = timestamp;
+    header.prevHash = prevHash.getBytes();
+    header.merkleRoot = merkleRootCached ? merkleRoot : BlockHeader::computeMerkleRoot(*transactions);
+    header.stateRoot = stateRoot;
+    header.bits = bits;
+    header.nonce = nonce;
+    return header;
+}
+
+long long Block::getTimestamp() const
+{
+    return timestamp;
+}
+
+uint32_t Block::getBits() const
+{
+    return bits;
+}
+
+uint64_t Block::getNonce() const
+{
+    return nonce;
+}
+
+const HashBytes& Block::getStateRoot() const
+{
+    return stateRoot;
+}
+
+void Block::setStateRoot(const HashBytes& root)
+{
+    stateRoot = root;
+}
+
+void Block::restoreHeader(const BlockHeader& header, const Hash256& hash)
+{
+    this->bits = header.bits;
+    this->hash = hash;
+    this->merkleRoot = header.merkleRoot;
+    this->merkleRootCached = true;
+    this->stateRoot = header.stateRoot;
+}
+
+std::shared_ptr<const std::vector<Transaction>> Block::getBody() const
+{
+    return bodyPruned ? nullptr : transactions;
+}
+
+bool Block::hasBody() const
+{
+    return !bodyPruned;
+}
+
+void Block::pruneBody()
+{
+    if (bodyPruned)
+    {
+        return;
+    }
+    if (!merkleRootCached)
+    {
+        merkleRoot = BlockHeader::computeMerkleRoot(*transactions);
+        merkleRootCached = true;
+    }
+    // Старое тело освободится, когда его отпустит последний читатель
+    transactions = std::make_shared<std::vector<Transaction>>();
+    bodyPruned = true;
+}
+
+void Block::checkBits(uint32_t bits)
+{
+    if ((bits & 0x007fffff) == 0)
+    {
+        throw std::invalid_argument("Target must be positive!");
+    }
+}
+
+bool Block::mineOnPool(uint32_t bits, int numThreads, const CancellationToken& token)
+{
+    const HashBytes target = BlockHeader::targetFromCompact(bits); // Хэш как big-endian число должен быть <= target
+    this->bits = bits;
+    BlockHeader header = getHeader(); // Merkle-корень считается один раз, дальше меняются только поля заголовка
+    merkleRoot = header.merkleRoot;
+    merkleRootCached = true;
+    const size_t threads = numThreads > 0 ? static_cast<size_t>(numThreads) : 0;
+    uint32_t extraNonce = static_cast<uint32_t>(this->nonce >> 32);
+    while (!token.isCancelled())
+    {
+        header.nonce = uint64_t(extraNonce) << 32;
+        const HeaderMidstate midstate(header);
+        uint32_t foundNonce = 0;
+        if (MiningPool::getInstance().mine(midstate, target, 0, uint64_t(1) << 32, token, foundNonce, threads))
+        {
+            this->timestamp = header.timestamp;
+            this->nonce = midstate.fullNonce(foundNonce);
+            this->hash = Hash256(midstate.hash(foundNonce));
+            return true;
+        }
+        if (token.isCancelled())
+        {
+            break;
+        }
+        // 2^32 nonce исчерпаны: следующий extra-nonce, после полного круга - сдвиг timestamp
+        if (++extraNonce == 0)
+        {
+            ++header.timestamp;
+            Logger::getInstance().log("Extra-nonce space exhausted for block " + std::to_string(index) +
+                                      ", rolling timestamp to " + std::to_string(header.timestamp));
+        }
+    }
+    return false;
+}
@@ -0,0 +1,143 @@
+#include "ChainQuery.h"
+#include <sstream>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+
+namespace {
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+void writeString(std::ostream& out, const std::string& value)
+{
+    out.put('"');
+    for (unsigned char c : value)
+    {
+        switch (c)
+        {
+        case '"': out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\r': out << "\\r"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if (c < 0x20)
+            {
+                out << "\\u00" << HEX_DIGITS[c >> 4] << HEX_DIGITS[c & 0x0f];
+            }
+            else
+            {
+                out.put(static_cast<char>(c));
+            }
+        }
+    }
+    out.put('"');
+}
+
+// Байт-код как в старом getChainInfo: "01 00 64"
+void writeCode(std::ostream& out, const std::vector<uint8_t>& code)
+{
+    out.put('"');
+    for (size_t i = 0; i < code.size(); ++i)
+    {
+        if (i > 0) out.put(' ');
+        out.put(HEX_DIGITS[code[i] >> 4]);
+        out.put(HEX_DIGITS[code[i] & 0x0f]);
+    }
+    out.put('"');
+}
+
+void writeTransaction(std::ostream& out, const Transaction& tx, uint32_t fields)
+{
+    out << "{\"sender\":";
+    writeString(out, tx.getSender());
+    out << ",\"recipient\":";
+    writeString(out, tx.getRecipient());
+    out << ",\"amount\":" << nlohmann::json(tx.getAmount()).dump(); // кратчайшая точная запись double
+    out << ",\"signature\":";
+    writeString(out, tx.getSignature());
+    if (fields & ChainQuery::TXID)
+    {
+        out << ",\"txid\":\"" << tx.getTxid().toHex() << '"';
+    }
+    if ((fields & ChainQuery::CONTRACT_CODE) && !tx.getContractCode().empty())
+    {
+        out << ",\"contractCode\":";
+        writeCode(out, tx.getContractCode());
+    }
+    if (!tx.getGltchCode().empty())
+    {
+        out << ",\"gltchCode\":";
+        writeString(out, tx.getGltchCode());
+    }
+    if (tx.getGasPrice() != Transaction::DEFAULT_GAS_PRICE)
+    {
+        out << ",\"gasPrice\":" << tx.getGasPrice();
+    }
+    out.put('}');
+}
+
+}
+
+uint32_t ChainQuery::parseFields(const std::string& list)
+{
+    uint32_t fields = 0;
+    std::stringstream ss(list);
+    std::string name;
+    while (std::getline(ss, name, ','))
+    {
+        if (name == "index") fields |= INDEX;
+        else if (name == "hash") fields |= HASH;
+        else if (name == "prevHash") fields |= PREV_HASH;
+        else if (name == "header") fields |= HEADER;
+        else if (name == "transactions") fields |= TRANSACTIONS;
+        else if (name == "contractCode") fields |= TRANSACTIONS | CONTRACT_CODE;
+        else if (name == "txid") fields |= TRANSACTIONS | TXID;
+        else if (name == "all") fields |= ALL_FIELDS;
+        else if (!name.empty()) throw std::invalid_argument("Unknown chain query field: " + name);
+    }
+    return fields;
+}
+
+void ChainQuery::writeBlock(std::ostream& out, const Block& block, const std::vector<Transaction>* body, uint32_t fields)
+{
+    const char* separator = "";
+    out.put('{');
+    if (fields & INDEX)
+    {
+        out << "\"index\":" << block.getIndex();
+        separator = ",";
+    }
+    if (fields & HASH)
+    {
+        out << separator << "\"hash\":\"" << block.getHash().toHex() << '"';
+        separator = ",";
+    }
+    if (fields & PREV_HASH)
+    {
+        out << separator << "\"prevHash\":\"" << block.getPrevHash().toHex() << '"';
+        separator = ",";
+    }
+    if (fields & HEADER)
+    {
+        out << separator << "\"timestamp\":" << block.getTimestamp() << ",\"bits\":\"" << BlockHeader::compactToString(block.getBits())
+            << "\",\"nonce\":" << block.getNonce() << ",\"stateRoot\":\"" << Hash256(block.getStateRoot()).toHex() << '"';
+        separator = ",";
+    }
+    if ((fields & TRANSACTIONS) && !body)
+    {
+        out << separator << "\"pruned\":true";
+    }
+    else if (fields & TRANSACTIONS)
+    {
+        out << separator << "\"transactions\":[";
+        const char* txSeparator = "";
+        for (const auto& tx : *body)
+        {
+            out << txSeparator;
+            writeTransaction(out, tx, fields);
+            txSeparator = ",";
+        }
+        out.put(']');
+    }
+    out.put('}');
+}
@@ -0,0 +1,38 @@
+#ifndef CHAINQUERY_H
+#define CHAINQUERY_H
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "Block.h"
+
+// Запрос диапазона блоков для обозревателей: страница [fromHeight, fromHeight + limit)
+// и набор полей. Ответ пишется в поток по блоку, без построения общего JSON-документа.
+struct ChainQuery
+{
+    enum Field : uint32_t
+    {
+        INDEX = 1u << 0,
+        HASH = 1u << 1,
+        PREV_HASH = 1u << 2,
+        HEADER = 1u << 3,        // timestamp, bits, nonce, stateRoot
+        TRANSACTIONS = 1u << 4,  // sender, recipient, amount, signature, gltchCode
+        CONTRACT_CODE = 1u << 5, // hex байт-кода внутри транзакций
+        TXID = 1u << 6
+    };
+    static constexpr uint32_t DEFAULT_FIELDS = INDEX | HASH | TRANSACTIONS | CONTRACT_CODE; // как в старом getChainInfo
+    static constexpr uint32_t ALL_FIELDS = INDEX | HASH | PREV_HASH | HEADER | TRANSACTIONS | CONTRACT_CODE | TXID;
+    static constexpr size_t MAX_LIMIT = 1000;
+
+    size_t fromHeight = 0;
+    size_t limit = 100; // обрезается до MAX_LIMIT
+    uint32_t fields = DEFAULT_FIELDS;
+
+    // Разбор списка полей вида "index,hash,header"; бросает std::invalid_argument на неизвестном поле
+    static uint32_t parseFields(const std::string& list);
+    // body - транзакции блока (Block::getBody() или прочитанные из BlockStore);
+    // nullptr - тело удалено на обрезанной ноде, вместо transactions пишется "pruned":true
+    static void writeBlock(std::ostream& out, const Block& block, const std::vector<Transaction>* body, uint32_t fields);
+};
+
+#endif // CHAINQUERY_H
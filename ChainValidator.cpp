@@ -0,0 +1,155 @@
+#include "ChainValidator.h"
+#include "Logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+
+ChainValidator::ChainValidator(uint32_t powLimitBits)
+    : powLimitBits(powLimitBits), powLimit(BlockHeader::targetFromCompact(powLimitBits)) {}
+
+bool ChainValidator::isRetargetHeight(size_t height)
+{
+    return height >= static_cast<size_t>(RETARGET_INTERVAL) && height % RETARGET_INTERVAL == 0;
+}
+
+uint32_t ChainValidator::scheduledBits(size_t height, const Block& parent, const Block* windowStart,
+                                       int64_t targetBlockInterval) const
+{
+    if (!isRetargetHeight(height))
+    {
+        return parent.getBits();
+    }
+    if (!windowStart)
+    {
+        throw std::invalid_argument("Retarget at height " + std::to_string(height) + " needs the block " +
+                                    std::to_string(height - RETARGET_INTERVAL));
+    }
+    if (targetBlockInterval <= 0 || targetBlockInterval > MAX_TARGET_BLOCK_INTERVAL)
+    {
+        throw std::invalid_argument("Target block interval out of range: " + std::to_string(targetBlockInterval));
+    }
+    // Время, за которое смайнены последние RETARGET_INTERVAL блоков, против ожидаемого.
+    // Метки времени приходят от пиров: разность с насыщением вместо переполнения
+    const int64_t last = parent.getTimestamp();
+    const int64_t first = windowStart->getTimestamp();
+    int64_t actualTimespan;
+    if (first < 0 && last > INT64_MAX + first)
+    {
+        actualTimespan = INT64_MAX;
+    }
+    else if (first > 0 && last < INT64_MIN + first)
+    {
+        actualTimespan = INT64_MIN;
+    }
+    else
+    {
+        actualTimespan = last - first;
+    }
+    const int64_t expectedTimespan = targetBlockInterval * (RETARGET_INTERVAL - 1);
+    return BlockHeader::retargetCompact(parent.getBits(), actualTimespan, expectedTimespan, powLimitBits);
+}
+
+bool ChainValidator::validate(const std::vector<const Block*>& blocks, size_t firstHeight, size_t checkFrom,
+                              int64_t targetBlockInterval, size_t& invalidHeight) const
+{
+    if (checkFrom < std::min<size_t>(RETARGET_INTERVAL, firstHeight + checkFrom) || checkFrom > blocks.size())
+    {
+        throw std::invalid_argument("Chain validation needs the preceding " + std::to_string(RETARGET_INTERVAL) +
+                                    " blocks as context");
+    }
+    const size_t count = blocks.size();
+    std::atomic<size_t> firstInvalid{count};
+    auto check = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end && i < firstInvalid.load(std::memory_order_relaxed); ++i)
+        {
+            if (!validateBlock(blocks, i, firstHeight + i, targetBlockInterval))
+            {
+                // Запоминаем минимальную ошибочную позицию
+                size_t current = firstInvalid.load();
+                while (i < current && !firstInvalid.compare_exchange_weak(current, i)) {}
+                return;
+            }
+        }
+    };
+
+    const size_t checked = count - checkFrom;
+    const size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                            (checked + BLOCKS_PER_THREAD - 1) / BLOCKS_PER_THREAD);
+    if (threads <= 1)
+    {
+        check(checkFrom, count);
+    }
+    else
+    {
+        const size_t perThread = (checked + threads - 1) / threads;
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < threads; ++t)
+        {
+            workers.emplace_back(check, checkFrom + t * perThread, std::min(count, checkFrom + (t + 1) * perThread));
+        }
+        check(checkFrom, checkFrom + perThread);
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    if (firstInvalid.load() < count)
+    {
+        invalidHeight = firstHeight + firstInvalid.load();
+        return false;
+    }
+    return true;
+}
+
+bool ChainValidator::validateBlock(const std::vector<const Block*>& blocks, size_t index, size_t height,
+                                   int64_t targetBlockInterval) const
+{
+    const Block& block = *blocks[index];
+    const Hash256 expectedPrevHash = index > 0 ? blocks[index - 1]->getHash() : Hash256();
+    if (block.getIndex() < 0 || static_cast<size_t>(block.getIndex()) != height)
+    {
+        Logger::getInstance().log("Validation: block at height " + std::to_string(height) + " has index " +
+                                  std::to_string(block.getIndex()));
+        return false;
+    }
+    if (block.getPrevHash() != expectedPrevHash)
+    {
+        Logger::getInstance().log("Validation: prevHash mismatch at height " + std::to_string(height));
+        return false;
+    }
+    const BlockHeader header = block.getHeader();
+    const HashBytes digest = header.hash();
+    if (Hash256(digest) != block.getHash())
+    {
+        Logger::getInstance().log("Validation: stored hash does not match header at height " + std::to_string(height));
+        return false;
+    }
+    const HashBytes target = BlockHeader::targetFromCompact(header.bits);
+    if ((header.bits & 0x007fffff) == 0 || !BlockHeader::meetsTarget(target, powLimit))
+    {
+        Logger::getInstance().log("Validation: target " + BlockHeader::compactToString(header.bits) +
+                                  " is above the PoW limit at height " + std::to_string(height));
+        return false;
+    }
+    if (height > 0)
+    {
+        const Block* windowStart = isRetargetHeight(height) ? blocks[index - RETARGET_INTERVAL] : nullptr;
+        const uint32_t expectedBits = scheduledBits(height, *blocks[index - 1], windowStart, targetBlockInterval);
+        if (header.bits != expectedBits)
+        {
+            Logger::getInstance().log("Validation: target " + BlockHeader::compactToString(header.bits) + " at height " +
+                                      std::to_string(height) + " does not follow the retarget schedule (expected " +
+                                      BlockHeader::compactToString(expectedBits) + ")");
+            return false;
+        }
+    }
+    if (!BlockHeader::meetsTarget(digest, target))
+    {
+        Logger::getInstance().log("Validation: hash does not meet target at height " + std::to_string(height));
+        return false;
+    }
+    return true;
+}
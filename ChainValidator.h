@@ -0,0 +1,45 @@
+#ifndef CHAINVALIDATOR_H
+#define CHAINVALIDATOR_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Block.h"
+#include "Hash256.h"
+
+// Проверка блоков цепочки: для каждого блока заново считается хэш заголовка
+// (Merkle-корень - по телу при загрузке, у выгруженных тел - из заголовка), хэш сравнивается с целью bits, проверяются высота
+// и связь prevHash. bits каждого блока после genesis должны совпадать с расписанием пересчёта сложности
+// (scheduledBits) - иначе блок мог бы сам выбрать себе цель полегче.
+// Блоки независимы, поэтому диапазон делится между потоками.
+class ChainValidator
+{
+public:
+    static constexpr int RETARGET_INTERVAL = 10; // сложность пересчитывается каждые N блоков
+    static constexpr int64_t MAX_TARGET_BLOCK_INTERVAL = 7 * 24 * 3600; // секунд; выше - бессмысленно и грозит переполнением
+
+    explicit ChainValidator(uint32_t powLimitBits);
+
+    uint32_t getPowLimitBits() const { return powLimitBits; }
+    static bool isRetargetHeight(size_t height);
+    // Цель блока height: bits родителя, а на высотах пересчёта - цель родителя, масштабированная
+    // временем последних RETARGET_INTERVAL блоков. windowStart - блок height - RETARGET_INTERVAL,
+    // нужен только на высотах пересчёта. targetBlockInterval - параметр консенсуса, секунд,
+    // в (0, MAX_TARGET_BLOCK_INTERVAL]; иначе std::invalid_argument.
+    uint32_t scheduledBits(size_t height, const Block& parent, const Block* windowStart, int64_t targetBlockInterval) const;
+
+    // blocks[i] - блок на высоте firstHeight + i. Первые checkFrom блоков уже проверены и служат
+    // контекстом (prevHash и окно пересчёта): их должно быть не меньше min(RETARGET_INTERVAL,
+    // firstHeight + checkFrom). true, если blocks[checkFrom..] корректны; иначе invalidHeight -
+    // наименьшая высота с ошибкой.
+    bool validate(const std::vector<const Block*>& blocks, size_t firstHeight, size_t checkFrom,
+                  int64_t targetBlockInterval, size_t& invalidHeight) const;
+
+private:
+    static constexpr size_t BLOCKS_PER_THREAD = 64; // меньше - потоки не окупаются
+    uint32_t powLimitBits;
+    HashBytes powLimit;
+    bool validateBlock(const std::vector<const Block*>& blocks, size_t index, size_t height,
+                       int64_t targetBlockInterval) const;
+};
+
+#endif // CHAINVALIDATOR_H
@@ -0,0 +1,33 @@
+#include "Crc32.h"
+
+namespace {
+
+struct Crc32Table
+{
+    uint32_t values[256];
+    Crc32Table()
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+            }
+            values[i] = crc;
+        }
+    }
+};
+
+}
+
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length)
+{
+    static const Crc32Table table;
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i)
+    {
+        crc = table.values[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
@@ -0,0 +1,15 @@
+#ifndef CRC32_H
+#define CRC32_H
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32 (IEEE 802.3, как в zlib) для контрольных сумм файлов ноды.
+// Для потоковой записи: crc = crc32Update(crc, ...) по кускам, начиная с 0.
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length);
+
+inline uint32_t crc32(const uint8_t* data, size_t length)
+{
+    return crc32Update(0, data, length);
+}
+
+#endif // CRC32_H
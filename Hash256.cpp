@@ -0,0 +1,64 @@
+#include "Hash256.h"
+#include <stdexcept>
+
+namespace {
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+// Значение hex-цифры или -1 для любого другого символа
+struct HexTable
+{
+    int8_t values[256];
+    HexTable()
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            values[i] = -1;
+        }
+        for (int i = 0; i < 10; ++i)
+        {
+            values['0' + i] = static_cast<int8_t>(i);
+        }
+        for (int i = 0; i < 6; ++i)
+        {
+            values['a' + i] = static_cast<int8_t>(10 + i);
+            values['A' + i] = static_cast<int8_t>(10 + i);
+        }
+    }
+};
+
+const HexTable HEX_TABLE;
+
+}
+
+Hash256 Hash256::fromHex(const std::string& hex)
+{
+    if (hex.size() != 2 * SIZE)
+    {
+        throw std::invalid_argument("Hash must be " + std::to_string(2 * SIZE) + " hex characters, got " +
+                                    std::to_string(hex.size()));
+    }
+    HashBytes bytes;
+    for (size_t i = 0; i < SIZE; ++i)
+    {
+        int hi = HEX_TABLE.values[static_cast<uint8_t>(hex[2 * i])];
+        int lo = HEX_TABLE.values[static_cast<uint8_t>(hex[2 * i + 1])];
+        if (hi < 0 || lo < 0)
+        {
+            throw std::invalid_argument("Hash contains non-hex characters: " + hex);
+        }
+        bytes[i] = static_cast<uint8_t>((hi << 4) | lo);
+    }
+    return Hash256(bytes);
+}
+
+std::string Hash256::toHex() const
+{
+    std::string hex(2 * SIZE, '0');
+    for (size_t i = 0; i < SIZE; ++i)
+    {
+        hex[2 * i] = HEX_DIGITS[bytes[i] >> 4];
+        hex[2 * i + 1] = HEX_DIGITS[bytes[i] & 0x0f];
+    }
+    return hex;
+}
@@ -0,0 +1,74 @@
+#ifndef HASH256_H
+#define HASH256_H
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using HashBytes = std::array<uint8_t, 32>;
+
+// 32-байтовый хэш блока. Внутри цепочки хэши хранятся и сравниваются в бинарном
+// виде; hex нужен только на границах (JSON, логи).
+class Hash256
+{
+public:
+    static constexpr size_t SIZE = 32;
+
+    Hash256() : bytes{} {}
+    explicit Hash256(const HashBytes& bytes) : bytes(bytes) {}
+
+    // Строго 64 hex-символа, иначе std::invalid_argument
+    static Hash256 fromHex(const std::string& hex);
+    std::string toHex() const;
+
+    const HashBytes& getBytes() const { return bytes; }
+    const uint8_t* data() const { return bytes.data(); }
+    bool isZero() const { return *this == Hash256(); }
+
+    // Два 128-битных сравнения вместо побайтового сравнения строк
+    friend bool operator==(const Hash256& a, const Hash256& b)
+    {
+#if defined(__SSE2__)
+        __m128i lo = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a.bytes.data())),
+                                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(b.bytes.data())));
+        __m128i hi = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a.bytes.data() + 16)),
+                                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(b.bytes.data() + 16)));
+        return _mm_movemask_epi8(_mm_and_si128(lo, hi)) == 0xffff;
+#else
+        return std::memcmp(a.bytes.data(), b.bytes.data(), SIZE) == 0;
+#endif
+    }
+    friend bool operator!=(const Hash256& a, const Hash256& b) { return !(a == b); }
+    friend bool operator<(const Hash256& a, const Hash256& b)
+    {
+        return std::memcmp(a.bytes.data(), b.bytes.data(), SIZE) < 0;
+    }
+
+private:
+    HashBytes bytes;
+};
+
+namespace std {
+template <>
+struct hash<Hash256>
+{
+    // Ведущие байты хэша блока - нули доказательства работы, поэтому префикс как ключ
+    // не годится: все четыре 64-битных слова сворачиваются XOR и перемешиваются финализатором splitmix64
+    size_t operator()(const Hash256& value) const noexcept
+    {
+        uint64_t words[4];
+        std::memcpy(words, value.data(), sizeof(words));
+        uint64_t mixed = words[0] ^ words[1] ^ words[2] ^ words[3];
+        mixed = (mixed ^ (mixed >> 30)) * 0xbf58476d1ce4e5b9ull;
+        mixed = (mixed ^ (mixed >> 27)) * 0x94d049bb133111ebull;
+        return static_cast<size_t>(mixed ^ (mixed >> 31));
+    }
+};
+}
+
+#endif // HASH256_H
@@ -0,0 +1,164 @@
+#include "Mempool.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+// Сколько подряд не влезших в остаток бюджета транзакций просматривается, прежде чем
+// сборка блока останавливается: иначе почти заполненный блок обходил бы весь пул
+constexpr size_t MAX_SKIPPED = 64;
+
+}
+
+Mempool::Mempool(size_t maxBytes) : limitBytes(maxBytes)
+{
+    if (maxBytes == 0)
+    {
+        throw std::invalid_argument("Mempool memory limit must be positive");
+    }
+}
+
+size_t Mempool::footprint(const Transaction& tx)
+{
+    // Кодировка, исходные поля, строка для логов и узлы четырёх индексов
+    return sizeof(Entry) + tx.serialize().size() + tx.getSender().size() + tx.getRecipient().size()
+           + tx.getSignature().size() + tx.getContractCode().size() + tx.getGltchCode().size()
+           + tx.toString().size() + sizeof(PriorityKey) + sizeof(Hash256) + sizeof(uint64_t)
+           + sizeof(Clock::time_point) + 96;
+}
+
+bool Mempool::add(const Transaction& tx)
+{
+    return add(tx, Clock::now());
+}
+
+bool Mempool::add(const Transaction& tx, Clock::time_point arrival)
+{
+    const Hash256& txid = tx.getTxid();
+    if (entries.count(txid))
+    {
+        return false;
+    }
+    auto own = senders.find(tx.getSender());
+    if (own != senders.end() && own->second.size() >= MAX_PER_SENDER)
+    {
+        return false;
+    }
+    const size_t size = footprint(tx);
+    if (usedBytes + size > limitBytes)
+    {
+        // Места хватит, только если вытеснить более дешёвые транзакции
+        size_t freed = 0;
+        for (auto it = priority.rbegin(); it != priority.rend() && usedBytes - freed + size > limitBytes; ++it)
+        {
+            if (it->gasPrice >= tx.getGasPrice())
+            {
+                return false;
+            }
+            freed += entries.find(it->txid)->second.bytes;
+        }
+        if (usedBytes - freed + size > limitBytes)
+        {
+            return false; // транзакция больше всего пула
+        }
+        while (usedBytes + size > limitBytes)
+        {
+            erase(entries.find(std::prev(priority.end())->txid));
+        }
+    }
+    const uint64_t sequence = nextSequence++;
+    entries.emplace(txid, Entry{tx, sequence, size, arrival});
+    senders[tx.getSender()].push_back(txid);
+    priority.insert(PriorityKey{tx.getGasPrice(), sequence, txid});
+    arrivals.emplace(arrival, sequence);
+    usedBytes += size;
+    totalGas += tx.getGasLimit();
+    encodedBytes += tx.serialize().size();
+    return true;
+}
+
+Mempool::Batch Mempool::takeTop(const Limits& limits)
+{
+    Batch batch;
+    std::vector<Hash256> taken;
+    size_t skipped = 0;
+    for (auto it = priority.begin(); it != priority.end() && batch.transactions.size() < limits.maxTransactions
+                                     && skipped < MAX_SKIPPED; ++it)
+    {
+        const Entry& entry = entries.find(it->txid)->second;
+        const int64_t gas = entry.tx.getGasLimit();
+        const size_t size = entry.tx.serialize().size();
+        if (gas > limits.maxGas - batch.gas || size > limits.maxBytes - batch.bytes)
+        {
+            ++skipped;
+            continue;
+        }
+        batch.gas += gas;
+        batch.bytes += size;
+        batch.transactions.push_back(entry.tx);
+        batch.arrivals.push_back(entry.arrival);
+        taken.push_back(it->txid);
+        skipped = 0;
+    }
+    for (const Hash256& txid : taken)
+    {
+        erase(entries.find(txid));
+    }
+    return batch;
+}
+
+Mempool::Clock::time_point Mempool::oldestArrival() const
+{
+    if (arrivals.empty())
+    {
+        throw std::logic_error("Mempool is empty");
+    }
+    return arrivals.begin()->first;
+}
+
+void Mempool::remove(const Hash256& txid)
+{
+    auto it = entries.find(txid);
+    if (it != entries.end())
+    {
+        erase(it);
+    }
+}
+
+bool Mempool::contains(const Hash256& txid) const
+{
+    return entries.count(txid) != 0;
+}
+
+std::vector<Transaction> Mempool::bySender(const std::string& sender) const
+{
+    std::vector<Transaction> result;
+    auto it = senders.find(sender);
+    if (it != senders.end())
+    {
+        for (const Hash256& txid : it->second)
+        {
+            result.push_back(entries.find(txid)->second.tx);
+        }
+    }
+    return result;
+}
+
+void Mempool::erase(std::unordered_map<Hash256, Entry>::iterator it)
+{
+    const Transaction& tx = it->second.tx;
+    auto sender = senders.find(tx.getSender());
+    std::vector<Hash256>& own = sender->second;
+    own.erase(std::find(own.begin(), own.end(), it->first));
+    if (own.empty())
+    {
+        senders.erase(sender);
+    }
+    priority.erase(PriorityKey{tx.getGasPrice(), it->second.sequence, it->first});
+    arrivals.erase({it->second.arrival, it->second.sequence});
+    usedBytes -= it->second.bytes;
+    totalGas -= tx.getGasLimit();
+    encodedBytes -= tx.serialize().size();
+    entries.erase(it);
+}
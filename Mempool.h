@@ -0,0 +1,97 @@
+#ifndef MEMPOOL_H
+#define MEMPOOL_H
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Hash256.h"
+#include "Transaction.h"
+
+// Пул неподтверждённых транзакций с ограничением по памяти.
+// Индексы: txid -> запись (дубликаты отбрасываются), отправитель -> его txid
+// (не больше MAX_PER_SENDER транзакций на отправителя), упорядоченное множество по
+// gasPrice (плата за единицу газа, сверх умолчания списывается - Transaction::getPriorityFee)
+// по убыванию, при равной цене - по времени прихода,
+// и порядок прихода (сколько ждёт самая старая транзакция - для SealingPolicy).
+// Когда занятая память превышает лимит, вытесняются самые дешёвые транзакции;
+// транзакция, которая сама оказалась бы самой дешёвой в полном пуле, не принимается.
+// Синхронизация - на вызывающем (Blockchain держит poolMutex).
+class Mempool
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t DEFAULT_MAX_BYTES = 64 << 20;
+    static constexpr size_t MAX_PER_SENDER = 64;
+
+    // Ограничения одного блока
+    struct Limits
+    {
+        size_t maxTransactions;
+        int64_t maxGas;   // суммарный gasLimit
+        size_t maxBytes;  // суммарный размер serialize()
+    };
+    struct Batch
+    {
+        std::vector<Transaction> transactions;
+        std::vector<Clock::time_point> arrivals; // когда пришла каждая из transactions
+        int64_t gas = 0;
+        size_t bytes = 0;
+    };
+
+    explicit Mempool(size_t maxBytes = DEFAULT_MAX_BYTES);
+    bool add(const Transaction& tx); // false - дубликат, лимит отправителя или вытеснена сразу
+    // То же для транзакции, возвращённой из несмайненного шаблона: ожидание считается от arrival
+    bool add(const Transaction& tx, Clock::time_point arrival);
+    // Забирает из пула самые дорогие транзакции, пока блок укладывается в limits
+    Batch takeTop(const Limits& limits);
+    void remove(const Hash256& txid); // транзакция попала в блок другим путём
+    bool contains(const Hash256& txid) const;
+    std::vector<Transaction> bySender(const std::string& sender) const;
+    size_t size() const { return entries.size(); }
+    size_t bytes() const { return usedBytes; } // занятая память, с накладными расходами индексов
+    size_t maxBytes() const { return limitBytes; }
+    int64_t pendingGas() const { return totalGas; }
+    size_t pendingBytes() const { return encodedBytes; } // суммарный размер serialize()
+    Clock::time_point oldestArrival() const; // пул не пуст
+
+private:
+    // Лучшая транзакция - первая в priority
+    struct PriorityKey
+    {
+        int64_t gasPrice;
+        uint64_t sequence;
+        Hash256 txid;
+
+        bool operator<(const PriorityKey& other) const
+        {
+            if (gasPrice != other.gasPrice) return gasPrice > other.gasPrice;
+            return sequence < other.sequence;
+        }
+    };
+    struct Entry
+    {
+        Transaction tx;
+        uint64_t sequence;
+        size_t bytes;
+        Clock::time_point arrival;
+    };
+
+    size_t limitBytes;
+    size_t usedBytes = 0;
+    int64_t totalGas = 0;
+    size_t encodedBytes = 0;
+    uint64_t nextSequence = 0;
+    std::unordered_map<Hash256, Entry> entries;
+    std::unordered_map<std::string, std::vector<Hash256>> senders;
+    std::set<PriorityKey> priority;
+    std::set<std::pair<Clock::time_point, uint64_t>> arrivals; // (время прихода, sequence)
+
+    static size_t footprint(const Transaction& tx);
+    void erase(std::unordered_map<Hash256, Entry>::iterator it);
+};
+
+#endif // MEMPOOL_H
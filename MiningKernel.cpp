@@ -0,0 +1,171 @@
+#include "MiningKernel.h"
+#include "Sha256Kernels.h"
+#include "Logger.h"
+#include <stdexcept>
+#include <chrono>
+#if defined(BLOCKCHAIN_X86_KERNELS)
+#include <cpuid.h>
+#endif
+
+namespace sha256kernels {
+
+const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+const uint32_t IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+}
+
+namespace {
+
+#if defined(BLOCKCHAIN_X86_KERNELS)
+bool cpuHasShaNi()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+    return (ebx & (1u << 29)) != 0 && __builtin_cpu_supports("sse4.1");
+}
+#endif
+
+}
+
+MiningKernel::MiningKernel() : type(Type::OPENSSL)
+{
+    // Соотношение скоростей ядер зависит от микроархитектуры (SHA-NI на AMD против
+    // AVX-512 на Intel), поэтому среди поддерживаемых CPUID ядер выбирается самое
+    // быстрое по короткому замеру на недостижимой цели
+    const BlockHeader header;
+    const HeaderMidstate midstate(header);
+    const HashBytes unreachable{};
+    double bestRate = 0.0;
+    Type selected = Type::OPENSSL;
+    for (Type candidate : supportedTypes())
+    {
+        type = candidate;
+        uint32_t unused;
+        auto start = std::chrono::steady_clock::now();
+        scan(midstate, unreachable, 0, CALIBRATION_NONCES, unused);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double rate = CALIBRATION_NONCES / (seconds > 0.0 ? seconds : 1e-9);
+        if (rate > bestRate)
+        {
+            bestRate = rate;
+            selected = candidate;
+        }
+    }
+    type = selected;
+    Logger::getInstance().log("Selected mining kernel: " + typeName(selected) + " (" +
+                              std::to_string(static_cast<long long>(bestRate)) + " H/s per thread)");
+}
+
+MiningKernel& MiningKernel::getInstance()
+{
+    static MiningKernel instance;
+    return instance;
+}
+
+MiningKernel::Type MiningKernel::getType() const
+{
+    return type;
+}
+
+void MiningKernel::setType(Type newType)
+{
+    if (!isSupported(newType))
+    {
+        throw std::invalid_argument("Mining kernel is not supported by this CPU: " + typeName(newType));
+    }
+    type = newType;
+    Logger::getInstance().log("Mining kernel switched to: " + typeName(newType));
+}
+
+bool MiningKernel::isSupported(Type candidate)
+{
+    switch (candidate)
+    {
+    case Type::OPENSSL:
+        return true;
+#if defined(BLOCKCHAIN_X86_KERNELS)
+    case Type::AVX2:
+        return __builtin_cpu_supports("avx2");
+    case Type::AVX512:
+        return __builtin_cpu_supports("avx512f");
+    case Type::SHA_NI:
+        return cpuHasShaNi();
+#endif
+    default:
+        return false;
+    }
+}
+
+std::vector<MiningKernel::Type> MiningKernel::supportedTypes()
+{
+    std::vector<Type> types;
+    for (Type candidate : {Type::OPENSSL, Type::AVX2, Type::AVX512, Type::SHA_NI})
+    {
+        if (isSupported(candidate))
+        {
+            types.push_back(candidate);
+        }
+    }
+    return types;
+}
+
+std::string MiningKernel::typeName(Type candidate)
+{
+    switch (candidate)
+    {
+    case Type::OPENSSL: return "openssl";
+    case Type::AVX2: return "avx2";
+    case Type::AVX512: return "avx512";
+    case Type::SHA_NI: return "sha-ni";
+    }
+    return "unknown";
+}
+
+bool MiningKernel::scan(const HeaderMidstate& midstate, const HashBytes& target,
+                        uint32_t firstNonce, uint32_t count, uint32_t& foundNonce) const
+{
+#if defined(BLOCKCHAIN_X86_KERNELS)
+    uint32_t targetWords[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        targetWords[i] = (uint32_t(target[4 * i]) << 24) | (uint32_t(target[4 * i + 1]) << 16)
+                         | (uint32_t(target[4 * i + 2]) << 8) | uint32_t(target[4 * i + 3]);
+    }
+    switch (type.load(std::memory_order_relaxed))
+    {
+    case Type::SHA_NI:
+        return sha256kernels::scanShaNi(midstate.midstateWords, midstate.tailWords, firstNonce, count, targetWords, &foundNonce);
+    case Type::AVX512:
+        return sha256kernels::scanAvx512(midstate.midstateWords, midstate.tailWords, firstNonce, count, targetWords, &foundNonce);
+    case Type::AVX2:
+        return sha256kernels::scanAvx2(midstate.midstateWords, midstate.tailWords, firstNonce, count, targetWords, &foundNonce);
+    default:
+        break;
+    }
+#endif
+    for (uint64_t done = 0; done < count; ++done)
+    {
+        uint32_t nonce = firstNonce + static_cast<uint32_t>(done);
+        if (BlockHeader::meetsTarget(midstate.hash(nonce), target))
+        {
+            foundNonce = nonce;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,36 @@
+#ifndef MININGKERNEL_H
+#define MININGKERNEL_H
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BlockHeader.h"
+
+// Выбор ядра перебора nonce. При первом обращении CPUID определяет доступные
+// расширения, из них по короткому замеру выбирается самое быстрое;
+// OpenSSL остаётся запасным вариантом.
+class MiningKernel
+{
+public:
+    enum class Type { OPENSSL, AVX2, AVX512, SHA_NI };
+
+    static MiningKernel& getInstance();
+    Type getType() const;
+    void setType(Type type); // для бенчмарков; бросает, если CPU не поддерживает ядро
+    static bool isSupported(Type type);
+    static std::vector<Type> supportedTypes();
+    static std::string typeName(Type type);
+
+    // Перебирает nonce из [firstNonce, firstNonce + count); true, если SHA256d заголовка <= target
+    bool scan(const HeaderMidstate& midstate, const HashBytes& target,
+              uint32_t firstNonce, uint32_t count, uint32_t& foundNonce) const;
+
+private:
+    static constexpr uint32_t CALIBRATION_NONCES = 1u << 14;
+    MiningKernel();
+    MiningKernel(const MiningKernel&) = delete;
+    MiningKernel& operator=(const MiningKernel&) = delete;
+    std::atomic<Type> type;
+};
+
+#endif // MININGKERNEL_H
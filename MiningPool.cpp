@@ -0,0 +1,173 @@
+#include "MiningPool.h"
+#include "MiningKernel.h"
+#include "Logger.h"
+#include <algorithm>
+
+CancellationToken::CancellationToken() : cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+
+void CancellationToken::cancel() const
+{
+    cancelled->store(true);
+}
+
+bool CancellationToken::isCancelled() const
+{
+    return cancelled->load(std::memory_order_relaxed);
+}
+
+MiningPool::MiningPool()
+{
+    size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        workers.emplace_back(&MiningPool::workerLoop, this, i);
+    }
+    Logger::getInstance().log("Mining pool started with " + std::to_string(threadCount) + " threads");
+}
+
+MiningPool::~MiningPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    jobReady.notify_all();
+    for (auto& worker : workers)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+}
+
+MiningPool& MiningPool::getInstance()
+{
+    static MiningPool instance;
+    return instance;
+}
+
+size_t MiningPool::getThreadCount() const
+{
+    return workers.size();
+}
+
+bool MiningPool::mine(const HeaderMidstate& midstate, const HashBytes& target, uint32_t firstNonce,
+                      uint64_t count, const CancellationToken& token, uint32_t& foundNonce, size_t maxThreads)
+{
+    std::lock_guard<std::mutex> submit(jobSubmitMutex);
+    Job job;
+    job.midstate = &midstate;
+    job.target = &target;
+    job.token = token;
+    job.firstNonce = firstNonce;
+    job.participants = (maxThreads == 0 || maxThreads > workers.size()) ? workers.size() : maxThreads;
+    job.segments.reset(new Segment[job.participants]);
+    uint64_t perSegment = count / job.participants;
+    for (size_t i = 0; i < job.participants; ++i)
+    {
+        job.segments[i].next = i * perSegment;
+        job.segments[i].end = (i + 1 == job.participants) ? count : (i + 1) * perSegment;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        currentJob = &job;
+        activeWorkers = job.participants;
+        ++generation;
+    }
+    jobReady.notify_all();
+    {
+        // Job живёт на стеке, поэтому ждём выхода всех участников, а не только находки
+        std::unique_lock<std::mutex> lock(stateMutex);
+        jobDone.wait(lock, [this] { return activeWorkers == 0; });
+        currentJob = nullptr;
+    }
+
+    if (job.found)
+    {
+        foundNonce = job.foundNonce;
+        return true;
+    }
+    return false;
+}
+
+void MiningPool::workerLoop(size_t workerId)
+{
+    uint64_t seenGeneration = 0;
+    while (true)
+    {
+        Job* job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            jobReady.wait(lock, [this, seenGeneration] { return stopping || generation != seenGeneration; });
+            if (stopping)
+            {
+                return;
+            }
+            seenGeneration = generation;
+            job = currentJob;
+        }
+        if (job == nullptr || workerId >= job->participants)
+        {
+            continue;
+        }
+        try
+        {
+            runJob(*job, workerId);
+        }
+        catch (const std::exception& e)
+        {
+            Logger::getInstance().log("Error in mining thread: " + std::string(e.what()));
+        }
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (--activeWorkers == 0)
+            {
+                jobDone.notify_all();
+            }
+        }
+    }
+}
+
+void MiningPool::runJob(Job& job, size_t workerId)
+{
+    const MiningKernel& kernel = MiningKernel::getInstance();
+    uint64_t begin;
+    uint64_t end;
+    while (!job.found.load(std::memory_order_relaxed) && !job.token.isCancelled()
+           && claimChunk(job, workerId, begin, end))
+    {
+        uint32_t nonce;
+        if (kernel.scan(*job.midstate, *job.target, job.firstNonce + static_cast<uint32_t>(begin),
+                        static_cast<uint32_t>(end - begin), nonce))
+        {
+            if (!job.found.exchange(true))
+            {
+                job.foundNonce = nonce;
+            }
+            return;
+        }
+    }
+}
+
+bool MiningPool::claimChunk(Job& job, size_t workerId, uint64_t& begin, uint64_t& end)
+{
+    // Сначала свой сегмент, затем по кругу чужие (кража работы)
+    for (size_t offset = 0; offset < job.participants; ++offset)
+    {
+        Segment& segment = job.segments[(workerId + offset) % job.participants];
+        if (segment.next.load(std::memory_order_relaxed) >= segment.end)
+        {
+            continue;
+        }
+        uint64_t claimed = segment.next.fetch_add(CHUNK);
+        if (claimed < segment.end)
+        {
+            begin = claimed;
+            end = std::min<uint64_t>(claimed + CHUNK, segment.end);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,79 @@
+#ifndef MININGPOOL_H
+#define MININGPOOL_H
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "BlockHeader.h"
+
+// Токен отмены майнинга: копии разделяют один флаг, cancel() виден всем держателям
+class CancellationToken
+{
+public:
+    CancellationToken();
+    void cancel() const;
+    bool isCancelled() const;
+
+private:
+    std::shared_ptr<std::atomic<bool>> cancelled;
+};
+
+// Долгоживущий пул потоков майнинга размером с число ядер. Диапазон nonce задания
+// делится на сегменты по числу потоков, каждый поток берёт из своего сегмента
+// пачки по CHUNK, а закончив свой - ворует пачки из чужих сегментов.
+class MiningPool
+{
+public:
+    static constexpr uint32_t CHUNK = 4096;
+
+    static MiningPool& getInstance();
+    size_t getThreadCount() const;
+
+    // Перебирает [firstNonce, firstNonce + count) не более чем maxThreads потоками
+    // (0 - все). Блокирует вызывающего до находки, исчерпания диапазона или отмены.
+    bool mine(const HeaderMidstate& midstate, const HashBytes& target, uint32_t firstNonce,
+              uint64_t count, const CancellationToken& token, uint32_t& foundNonce, size_t maxThreads = 0);
+
+private:
+    struct Segment
+    {
+        std::atomic<uint64_t> next{0};
+        uint64_t end = 0;
+    };
+
+    struct Job
+    {
+        const HeaderMidstate* midstate = nullptr;
+        const HashBytes* target = nullptr;
+        CancellationToken token;
+        uint32_t firstNonce = 0;
+        size_t participants = 0;
+        std::unique_ptr<Segment[]> segments;
+        std::atomic<bool> found{false};
+        uint32_t foundNonce = 0;
+    };
+
+    MiningPool();
+    ~MiningPool();
+    MiningPool(const MiningPool&) = delete;
+    MiningPool& operator=(const MiningPool&) = delete;
+
+    void workerLoop(size_t workerId);
+    void runJob(Job& job, size_t workerId);
+    bool claimChunk(Job& job, size_t workerId, uint64_t& begin, uint64_t& end);
+
+    std::vector<std::thread> workers;
+    std::mutex jobSubmitMutex; // задания выполняются по одному
+    std::mutex stateMutex;
+    std::condition_variable jobReady;
+    std::condition_variable jobDone;
+    Job* currentJob = nullptr;
+    uint64_t generation = 0;
+    size_t activeWorkers = 0;
+    bool stopping = false;
+};
+
+#endif // MININGPOOL_H
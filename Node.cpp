@@ -4,6 +4,7 @@
 #include "Logger.h"
 #include <nlohmann/json.hpp>
 #include <sstream>
+#include <optional>
 #include <functional>
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
@@ -12,6 +13,68 @@
 using json = nlohmann::json;
 using boost::asio::ip::tcp;
 
+namespace {
+
+json transactionToJson(const Transaction& tx) {
+    return {
+        {"sender", tx.getSender()},
+        {"recipient", tx.getRecipient()},
+        {"amount", tx.getAmount()},
+        {"signature", tx.getSignature()},
+        {"contractCode", tx.getContractCode()},
+        {"gltchCode", tx.getGltchCode()},
+        {"gasLimit", tx.getGasLimit()},
+        {"gasPrice", tx.getGasPrice()}
+    };
+}
+
+json headerToJson(const BlockHeader& header) {
+    return {
+        {"version", header.version},
+        {"timestamp", header.timestamp},
+        {"merkleRoot", Hash256(header.merkleRoot).toHex()},
+        {"stateRoot", Hash256(header.stateRoot).toHex()},
+        {"bits", header.bits},
+        {"nonce", header.nonce}
+    };
+}
+
+// Заголовок из сообщения "block": index и prevHash - из самого сообщения
+BlockHeader headerFromJson(const json& data, uint32_t index, const Hash256& prevHash) {
+    BlockHeader header;
+    header.version = data.at("version").get<uint32_t>();
+    header.index = index;
+    header.timestamp = data.at("timestamp").get<int64_t>();
+    header.prevHash = prevHash.getBytes();
+    header.merkleRoot = Hash256::fromHex(data.at("merkleRoot").get<std::string>()).getBytes();
+    header.stateRoot = Hash256::fromHex(data.at("stateRoot").get<std::string>()).getBytes();
+    header.bits = data.at("bits").get<uint32_t>();
+    header.nonce = data.at("nonce").get<uint64_t>();
+    return header;
+}
+
+// nullopt (с записью в лог) для некорректной транзакции - остальные в сообщении принимаются
+std::optional<Transaction> transactionFromJson(const json& data) {
+    std::string sender = data.value("sender", "");
+    std::string recipient = data.value("recipient", "");
+    if (sender.empty() || recipient.empty()) {
+        Logger::getInstance().log("Invalid transaction: sender or recipient empty");
+        return std::nullopt;
+    }
+    try {
+        return Transaction(sender, recipient, data.value("amount", 0.0), data.value("signature", ""),
+                           data.contains("contractCode") ? data["contractCode"].get<std::vector<uint8_t>>() : std::vector<uint8_t>(),
+                           data.value("gasLimit", int64_t(0)),
+                           data.contains("gltchCode") ? data["gltchCode"].get<std::string>() : "",
+                           data.value("gasPrice", Transaction::DEFAULT_GAS_PRICE));
+    } catch (const std::invalid_argument& e) {
+        Logger::getInstance().log("Invalid transaction from " + sender + ": " + e.what());
+        return std::nullopt;
+    }
+}
+
+}
+
 Node::Node(std::string host, unsigned short port, Blockchain& blockchain)
     : host(host), port(port), blockchain(blockchain), acceptor(io_context) {
     try {
@@ -128,22 +191,24 @@ void Node::handleMessage(const std::string& message) {
                 Logger::getInstance().log("Transaction message missing 'data' field: " + message);
                 return;
             }
-            auto data = parsed["data"];
-            std::string sender = data.value("sender", "");
-            std::string recipient = data.value("recipient", "");
-            double amount = data.value("amount", 0.0);
-            std::string signature = data.value("signature", "");
-            std::vector<uint8_t> contractCode = data.contains("contractCode") ?
-                                                    data["contractCode"].get<std::vector<uint8_t>>() : std::vector<uint8_t>();
-            std::string gltchCode = data.contains("gltchCode") ? data["gltchCode"].get<std::string>() : "";
-            int64_t gasLimit = data.value("gasLimit", 0);
-            if (sender.empty() || recipient.empty()) {
-                Logger::getInstance().log("Invalid transaction: sender or recipient empty");
+            std::optional<Transaction> tx = transactionFromJson(parsed["data"]);
+            if (tx) {
+                blockchain.addTransaction(std::move(*tx)); // только ставится в очередь приёма
+            }
+        } else if (type == "transactions") {
+            if (!parsed.contains("data") || !parsed["data"].is_array()) {
+                Logger::getInstance().log("Transactions message missing 'data' array");
                 return;
             }
-            Transaction tx(sender, recipient, amount, signature, contractCode, gasLimit, gltchCode);
-            blockchain.addTransaction(tx);
-            Logger::getInstance().log("Processed transaction: " + sender + " -> " + recipient + ", amount: " + std::to_string(amount));
+            std::vector<Transaction> transactions;
+            transactions.reserve(parsed["data"].size());
+            for (const auto& tx_data : parsed["data"]) {
+                if (std::optional<Transaction> tx = transactionFromJson(tx_data)) {
+                    transactions.push_back(std::move(*tx));
+                }
+            }
+            Logger::getInstance().log("Received " + std::to_string(transactions.size()) + " transactions");
+            blockchain.addTransactions(std::move(transactions));
         } else if (type == "block") {
             if (!parsed.contains("data")) {
                 Logger::getInstance().log("Block message missing 'data' field: " + message);
@@ -151,32 +216,53 @@ void Node::handleMessage(const std::string& message) {
             }
             auto data = parsed["data"];
             int index = data.value("index", -1);
-            std::string prevHash = data.value("prevHash", "");
+            std::string prevHashHex = data.value("prevHash", "");
             std::vector<Transaction> transactions;
             if (data.contains("transactions")) {
                 for (const auto& tx_data : data["transactions"]) {
-                    std::string tx_sender = tx_data.value("sender", "");
-                    std::string tx_recipient = tx_data.value("recipient", "");
-                    double tx_amount = tx_data.value("amount", 0.0);
-                    std::string tx_signature = tx_data.value("signature", "");
-                    std::vector<uint8_t> tx_contractCode = tx_data.contains("contractCode") ?
-                                                               tx_data["contractCode"].get<std::vector<uint8_t>>() : std::vector<uint8_t>();
-                    std::string tx_gltchCode = tx_data.contains("gltchCode") ? tx_data["gltchCode"].get<std::string>() : "";
-                    int64_t tx_gasLimit = tx_data.value("gasLimit", 0);
-                    if (tx_sender.empty() || tx_recipient.empty()) {
-                        Logger::getInstance().log("Invalid transaction in block: sender or recipient empty");
-                        continue;
+                    if (std::optional<Transaction> tx = transactionFromJson(tx_data)) {
+                        transactions.push_back(std::move(*tx));
                     }
-                    transactions.emplace_back(tx_sender, tx_recipient, tx_amount, tx_signature,
-                                              tx_contractCode, tx_gasLimit, tx_gltchCode);
                 }
             }
-            if (index < 0 || prevHash.empty()) {
-                Logger::getInstance().log("Invalid block: index=" + std::to_string(index) + ", prevHash=" + prevHash);
+            if (index < 0 || prevHashHex.empty()) {
+                Logger::getInstance().log("Invalid block: index=" + std::to_string(index) + ", prevHash=" + prevHashHex);
+                return;
+            }
+            Hash256 prevHash = Hash256::fromHex(prevHashHex); // hex разбирается один раз на входе
+            std::string hashHex = data.value("hash", "");
+            if (!hashHex.empty() && blockchain.getBlockByHash(Hash256::fromHex(hashHex))) {
+                Logger::getInstance().log("Ignoring already known block: " + hashHex);
+                return;
+            }
+            std::shared_ptr<const Block> parent = blockchain.getBlockByHash(prevHash);
+            if (!parent) {
+                Logger::getInstance().log("Ignoring block " + std::to_string(index) + " with unknown prevHash=" + prevHashHex);
                 return;
             }
-            auto block = RegularBlockFactory().createRegularBlock(index, std::time(nullptr), transactions, prevHash, 0);
-            blockchain.addBlock(transactions);
+            if (blockchain.getBlockByHeight(static_cast<size_t>(parent->getIndex()) + 1)) {
+                // Устаревший блок или чужая ветка: переключение веток - через rollbackBlocks, не здесь
+                Logger::getInstance().log("Ignoring block " + std::to_string(index) + " built on non-tip block " +
+                                          std::to_string(parent->getIndex()));
+                return;
+            }
+            if (!data.contains("header") || hashHex.empty()) {
+                Logger::getInstance().log("Ignoring block " + std::to_string(index) + " without header");
+                return;
+            }
+            // Майнинг прерывается только ради блока с настоящим PoW над этими же транзакциями
+            const BlockHeader header = headerFromJson(data["header"], static_cast<uint32_t>(index), prevHash);
+            if (header.version != BlockHeader::CURRENT_VERSION ||
+                header.merkleRoot != BlockHeader::computeMerkleRoot(transactions) ||
+                Hash256(header.hash()) != Hash256::fromHex(hashHex)) {
+                Logger::getInstance().log("Ignoring block " + std::to_string(index) + " whose header does not match its hash or transactions");
+                return;
+            }
+            if (!blockchain.preemptMining(header)) { // Пир опередил нас - текущий майнинг больше не нужен
+                Logger::getInstance().log("Ignoring block " + std::to_string(index) + ": not a valid successor of our tip");
+                return;
+            }
+            blockchain.submitBlock(transactions); // Не блокируем поток приёма на время майнинга
             Logger::getInstance().log("Processed block with index: " + std::to_string(index));
         } else {
             Logger::getInstance().log("Unknown message type: " + type);
@@ -211,73 +297,43 @@ void Node::connectToPeer(std::string host, unsigned short port) {
 void Node::broadcastTransaction(const Transaction& tx) {
     json message;
     message["type"] = "transaction";
-    message["data"] = {
-        {"sender", tx.getSender()},
-        {"recipient", tx.getRecipient()},
-        {"amount", tx.getAmount()},
-        {"signature", tx.getSignature()},
-        {"contractCode", tx.getContractCode()},
-        {"gltchCode", tx.getGltchCode()},
-        {"gasLimit", tx.getGasLimit()}
-    };
-    std::string message_str = message.dump() + "\n";
-    std::vector<std::string> current_peers;
-    {
-        std::lock_guard<std::mutex> lock(peers_mutex);
-        current_peers = peers;
+    message["data"] = transactionToJson(tx);
+    sendToPeers(message.dump() + "\n", "transaction");
+}
+
+void Node::broadcastTransactions(const std::vector<Transaction>& transactions) {
+    if (transactions.size() == 1) {
+        broadcastTransaction(transactions.front());
+        return;
     }
-    for (const auto& peer : current_peers) {
-        std::string peer_host;
-        unsigned short peer_port;
-        std::stringstream ss(peer);
-        std::getline(ss, peer_host, ':');
-        ss >> peer_port;
-        auto socket = std::make_shared<tcp::socket>(io_context);
-        boost::system::error_code ec;
-        tcp::endpoint endpoint(boost::asio::ip::make_address(peer_host, ec), peer_port);
-        if (ec) {
-            Logger::getInstance().log("Invalid address for peer " + peer + ": " + ec.message());
-            continue;
-        }
-        socket->async_connect(endpoint, [this, socket, message_str, peer](const boost::system::error_code& error) {
-            if (!error) {
-                boost::asio::async_write(*socket, boost::asio::buffer(message_str),
-                                         [this, peer](const boost::system::error_code& error, std::size_t /* bytes_transferred */) {
-                                             if (!error) {
-                                                 Logger::getInstance().log("Sent transaction to " + peer);
-                                             } else {
-                                                 Logger::getInstance().log("Write error to " + peer + ": " + error.message());
-                                             }
-                                         });
-            } else {
-                Logger::getInstance().log("Connect error to " + peer + ": " + error.message());
-            }
-        });
+    json message;
+    message["type"] = "transactions";
+    json txs = json::array();
+    for (const auto& tx : transactions) {
+        txs.push_back(transactionToJson(tx));
     }
+    message["data"] = std::move(txs);
+    sendToPeers(message.dump() + "\n", std::to_string(transactions.size()) + " transactions");
 }
 
-void Node::broadcastBlock(const std::unique_ptr<Block>& block) {
+void Node::broadcastBlock(const Block& block) {
     json message;
     message["type"] = "block";
     json txs;
-    for (const auto& tx : block->getTransactions()) {
-        txs.push_back({
-            {"sender", tx.getSender()},
-            {"recipient", tx.getRecipient()},
-            {"amount", tx.getAmount()},
-            {"signature", tx.getSignature()},
-            {"contractCode", tx.getContractCode()},
-            {"gltchCode", tx.getGltchCode()},
-            {"gasLimit", tx.getGasLimit()}
-        });
+    for (const auto& tx : block.getTransactions()) {
+        txs.push_back(transactionToJson(tx));
     }
     message["data"] = {
-        {"index", block->getIndex()},
-        {"hash", block->getHash()},
-        {"prevHash", block->getPrevHash()},
+        {"index", block.getIndex()},
+        {"hash", block.getHash().toHex()},
+        {"prevHash", block.getPrevHash().toHex()},
+        {"header", headerToJson(block.getHeader())},
         {"transactions", txs}
     };
-    std::string message_str = message.dump() + "\n";
+    sendToPeers(message.dump() + "\n", "block");
+}
+
+void Node::sendToPeers(const std::string& message_str, const std::string& what) {
     std::vector<std::string> current_peers;
     {
         std::lock_guard<std::mutex> lock(peers_mutex);
@@ -296,12 +352,12 @@ void Node::broadcastBlock(const std::unique_ptr<Block>& block) {
             Logger::getInstance().log("Invalid address for peer " + peer + ": " + ec.message());
             continue;
         }
-        socket->async_connect(endpoint, [this, socket, message_str, peer](const boost::system::error_code& error) {
+        socket->async_connect(endpoint, [this, socket, message_str, peer, what](const boost::system::error_code& error) {
             if (!error) {
                 boost::asio::async_write(*socket, boost::asio::buffer(message_str),
-                                         [this, peer](const boost::system::error_code& error, std::size_t /* bytes_transferred */) {
+                                         [this, peer, what](const boost::system::error_code& error, std::size_t /* bytes_transferred */) {
                                              if (!error) {
-                                                 Logger::getInstance().log("Sent block to " + peer);
+                                                 Logger::getInstance().log("Sent " + what + " to " + peer);
                                              } else {
                                                  Logger::getInstance().log("Write error to " + peer + ": " + error.message());
                                              }
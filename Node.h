@@ -15,7 +15,8 @@ public:
     void start();
     void connectToPeer(std::string host, unsigned short port);
     void broadcastTransaction(const Transaction& tx);
-    void broadcastBlock(const std::unique_ptr<Block>& block);
+    void broadcastTransactions(const std::vector<Transaction>& transactions); // одним сообщением "transactions"
+    void broadcastBlock(const Block& block);
 
 private:
     std::string host;
@@ -29,6 +30,7 @@ private:
 
     void handleConnection(std::shared_ptr<boost::asio::ip::tcp::socket> socket);
     void handleMessage(const std::string& message);
+    void sendToPeers(const std::string& message_str, const std::string& what); // what - для лога
 };
 
 #endif // NODE_H
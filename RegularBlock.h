@@ -11,16 +11,17 @@
 class RegularBlock:public Block
 {
     friend class RegularBlockFactory;
+    RegularBlock(const BlockHeader& header, const Hash256& hash); // только заголовок, тело выгружено
 public:
-    RegularBlock(int index,long long timestamp,std::vector<Transaction> transactions,std::string prevHash,int nonce);
+    RegularBlock(int index,long long timestamp,std::vector<Transaction> transactions,const Hash256& prevHash,uint64_t nonce);
 
-    std::string calculateHash() const override;
-    void mineBlockParallel(int difficulty, int numThreads) override;
-    void mineBlock(int difficulty)override;
+    Hash256 calculateHash() const override;
+    bool mineBlockParallel(uint32_t bits, int numThreads, const CancellationToken& token = CancellationToken()) override;
+    void mineBlock(uint32_t bits)override;
     int getIndex() const override;
-    std::string getHash()const override;
+    const Hash256& getHash()const override;
     const std::vector<Transaction>& getTransactions() const override;
-    std::string getPrevHash() const override;
+    const Hash256& getPrevHash() const override;
 };
 
 #endif // REGULARBLOCK_H
@@ -0,0 +1,74 @@
+#include "SealingPolicy.h"
+#include <algorithm>
+#include <stdexcept>
+
+SealingPolicy::SealingPolicy(const Config& config)
+{
+    setConfig(config);
+}
+
+void SealingPolicy::setConfig(const Config& config)
+{
+    if (config.maxTransactions == 0)
+        throw std::invalid_argument("Sealing policy: max transactions must be positive!");
+    if (config.maxGas <= 0)
+        throw std::invalid_argument("Sealing policy: max gas must be positive!");
+    if (config.maxBytes == 0)
+        throw std::invalid_argument("Sealing policy: max bytes must be positive!");
+    if (config.maxWait.count() < 0)
+        throw std::invalid_argument("Sealing policy: max wait cannot be negative!");
+    this->config = config;
+}
+
+Mempool::Limits SealingPolicy::limits() const
+{
+    return Mempool::Limits{config.maxTransactions, config.maxGas, config.maxBytes};
+}
+
+SealingPolicy::Reason SealingPolicy::check(const Mempool& pool, Clock::time_point now) const
+{
+    if (pool.size() == 0)
+        return NONE;
+    if (pool.size() >= config.maxTransactions)
+        return TRANSACTIONS;
+    if (pool.pendingGas() >= config.maxGas)
+        return GAS;
+    if (pool.pendingBytes() >= config.maxBytes)
+        return BYTES;
+    if (now >= deadline(pool))
+        return LATENCY;
+    return NONE;
+}
+
+SealingPolicy::Clock::time_point SealingPolicy::deadline(const Mempool& pool) const
+{
+    return pool.oldestArrival() + config.maxWait;
+}
+
+void SealingPolicy::record(Reason reason, const Mempool::Batch& batch, Clock::time_point now)
+{
+    ++metrics.blocks;
+    ++metrics.sealedBy[reason];
+    metrics.transactions += batch.transactions.size();
+    metrics.gas += static_cast<uint64_t>(batch.gas);
+    metrics.bytes += batch.bytes;
+    for (Clock::time_point arrival : batch.arrivals)
+    {
+        const uint64_t wait = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(now - arrival).count());
+        metrics.totalWaitMicros += wait;
+        metrics.maxWaitMicros = std::max(metrics.maxWaitMicros, wait);
+    }
+}
+
+const char* SealingPolicy::reasonName(Reason reason)
+{
+    switch (reason)
+    {
+    case TRANSACTIONS: return "transactions";
+    case GAS: return "gas";
+    case BYTES: return "bytes";
+    case LATENCY: return "latency";
+    default: return "none";
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef SEALINGPOLICY_H
+#define SEALINGPOLICY_H
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "Mempool.h"
+
+// Когда запечатывать блок из мемпула: по первому сработавшему порогу - число транзакций,
+// суммарный газ, суммарный размер или время ожидания самой старой транзакции.
+// Пороги объёма одновременно ограничивают сам блок (Mempool::Limits).
+// Крупные блоки дешевле на транзакцию (один раунд майнинга и рассылки на всех),
+// maxWait ограничивает задержку при слабой нагрузке. Метрики показывают, какой порог
+// срабатывает и сколько транзакции ждут, - по ним пороги подбираются под развёртывание.
+// Синхронизация - на вызывающем (Blockchain держит poolMutex).
+class SealingPolicy
+{
+public:
+    using Clock = Mempool::Clock;
+
+    enum Reason
+    {
+        NONE,
+        TRANSACTIONS,
+        GAS,
+        BYTES,
+        LATENCY,
+        REASON_COUNT
+    };
+
+    struct Config
+    {
+        size_t maxTransactions = 1000;
+        int64_t maxGas = 10000000;
+        size_t maxBytes = 1 << 20;                  // сериализованных транзакций
+        std::chrono::milliseconds maxWait{2000};    // 0 - запечатывать сразу
+    };
+
+    struct Metrics
+    {
+        uint64_t blocks = 0;
+        uint64_t sealedBy[REASON_COUNT] = {}; // сколько блоков запечатано каждым порогом
+        uint64_t transactions = 0;
+        uint64_t gas = 0;
+        uint64_t bytes = 0;
+        uint64_t totalWaitMicros = 0; // сумма ожиданий транзакций от прихода до запечатывания
+        uint64_t maxWaitMicros = 0;
+        size_t pendingTransactions = 0; // мемпул на момент снятия метрик
+        size_t pendingBytes = 0;
+
+        double averageTransactions() const { return blocks ? double(transactions) / blocks : 0; }
+        double averageWaitMillis() const { return transactions ? totalWaitMicros / 1000.0 / transactions : 0; }
+    };
+
+    SealingPolicy() = default;
+    explicit SealingPolicy(const Config& config);
+
+    const Config& getConfig() const { return config; }
+    void setConfig(const Config& config); // бросает std::invalid_argument на нулевых порогах; метрики сохраняются
+    Mempool::Limits limits() const;
+    Reason check(const Mempool& pool, Clock::time_point now) const; // NONE - пока рано
+    Clock::time_point deadline(const Mempool& pool) const; // когда сработает maxWait; пул не пуст
+    void record(Reason reason, const Mempool::Batch& batch, Clock::time_point now);
+    const Metrics& getMetrics() const { return metrics; }
+    static const char* reasonName(Reason reason);
+
+private:
+    Config config;
+    Metrics metrics;
+};
+
+#endif // SEALINGPOLICY_H
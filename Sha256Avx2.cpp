@@ -0,0 +1,35 @@
+// Собирается с -mavx2: 8 nonce на вектор
+#include <immintrin.h>
+#include "Sha256Lanes.h"
+
+namespace sha256kernels {
+namespace {
+
+struct Avx2Ops
+{
+    using Vec = __m256i;
+    static constexpr int LANES = 8;
+
+    static inline Vec set1(uint32_t x) { return _mm256_set1_epi32(static_cast<int>(x)); }
+    static inline Vec load(const uint32_t* p) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(p)); }
+    static inline void store(uint32_t* p, Vec x) { _mm256_store_si256(reinterpret_cast<__m256i*>(p), x); }
+    static inline Vec add(Vec a, Vec b) { return _mm256_add_epi32(a, b); }
+    static inline Vec bitAnd(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+    static inline Vec bitOr(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+    static inline Vec xor3(Vec a, Vec b, Vec c) { return _mm256_xor_si256(_mm256_xor_si256(a, b), c); }
+    template <int N> static inline Vec shr(Vec x) { return _mm256_srli_epi32(x, N); }
+    template <int N> static inline Vec shl(Vec x) { return _mm256_slli_epi32(x, N); }
+    template <int N> static inline Vec rotr(Vec x) { return _mm256_or_si256(_mm256_srli_epi32(x, N), _mm256_slli_epi32(x, 32 - N)); }
+    static inline Vec ch(Vec e, Vec f, Vec g) { return _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g)); }
+    static inline Vec maj(Vec a, Vec b, Vec c) { return _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b))); }
+};
+
+}
+
+bool scanAvx2(const uint32_t midstate[8], const uint32_t tailWords[16], uint32_t firstNonce,
+              uint32_t count, const uint32_t target[8], uint32_t* foundNonce)
+{
+    return Lanes<Avx2Ops>::scan(midstate, tailWords, firstNonce, count, target, foundNonce);
+}
+
+}
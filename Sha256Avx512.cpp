@@ -0,0 +1,35 @@
+// Собирается с -mavx512f: 16 nonce на вектор, нативный ror и ternarylogic для Ch/Maj
+#include <immintrin.h>
+#include "Sha256Lanes.h"
+
+namespace sha256kernels {
+namespace {
+
+struct Avx512Ops
+{
+    using Vec = __m512i;
+    static constexpr int LANES = 16;
+
+    static inline Vec set1(uint32_t x) { return _mm512_set1_epi32(static_cast<int>(x)); }
+    static inline Vec load(const uint32_t* p) { return _mm512_load_si512(p); }
+    static inline void store(uint32_t* p, Vec x) { _mm512_store_si512(p, x); }
+    static inline Vec add(Vec a, Vec b) { return _mm512_add_epi32(a, b); }
+    static inline Vec bitAnd(Vec a, Vec b) { return _mm512_and_si512(a, b); }
+    static inline Vec bitOr(Vec a, Vec b) { return _mm512_or_si512(a, b); }
+    static inline Vec xor3(Vec a, Vec b, Vec c) { return _mm512_ternarylogic_epi32(a, b, c, 0x96); }
+    template <int N> static inline Vec shr(Vec x) { return _mm512_srli_epi32(x, N); }
+    template <int N> static inline Vec shl(Vec x) { return _mm512_slli_epi32(x, N); }
+    template <int N> static inline Vec rotr(Vec x) { return _mm512_ror_epi32(x, N); }
+    static inline Vec ch(Vec e, Vec f, Vec g) { return _mm512_ternarylogic_epi32(e, f, g, 0xCA); }
+    static inline Vec maj(Vec a, Vec b, Vec c) { return _mm512_ternarylogic_epi32(a, b, c, 0xE8); }
+};
+
+}
+
+bool scanAvx512(const uint32_t midstate[8], const uint32_t tailWords[16], uint32_t firstNonce,
+                uint32_t count, const uint32_t target[8], uint32_t* foundNonce)
+{
+    return Lanes<Avx512Ops>::scan(midstate, tailWords, firstNonce, count, target, foundNonce);
+}
+
+}
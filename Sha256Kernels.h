@@ -0,0 +1,43 @@
+#ifndef SHA256KERNELS_H
+#define SHA256KERNELS_H
+#include <cstdint>
+
+// Низкоуровневые ядра SHA256d для перебора nonce. Каждое ядро собирается в своей
+// единице трансляции со своими флагами ISA, поэтому здесь только plain C типы.
+//
+// midstate  - состояние SHA-256 после первых BlockHeader::MIDSTATE_SIZE байт заголовка
+// tailWords - последний блок SHA-256 (хвост заголовка + паддинг) в big-endian словах,
+//             слово NONCE_WORD заменяется на младшие 32 бита nonce каждой попытки,
+//             старшие 32 бита (extra-nonce) уже лежат в следующем слове
+// target    - цель в виде 8 big-endian слов; подходит хэш <= target
+// Возвращает true и первый подходящий младший nonce из [firstNonce, firstNonce + count).
+
+namespace sha256kernels {
+
+constexpr int NONCE_WORD = 0; // (NONCE_OFFSET - MIDSTATE_SIZE) / 4
+
+extern const uint32_t K[64];
+extern const uint32_t IV[8];
+
+bool scanShaNi(const uint32_t midstate[8], const uint32_t tailWords[16], uint32_t firstNonce,
+               uint32_t count, const uint32_t target[8], uint32_t* foundNonce);
+bool scanAvx2(const uint32_t midstate[8], const uint32_t tailWords[16], uint32_t firstNonce,
+              uint32_t count, const uint32_t target[8], uint32_t* foundNonce);
+bool scanAvx512(const uint32_t midstate[8], const uint32_t tailWords[16], uint32_t firstNonce,
+                uint32_t count, const uint32_t target[8], uint32_t* foundNonce);
+
+inline bool meetsTarget(const uint32_t digest[8], const uint32_t target[8])
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        if (digest[i] != target[i])
+        {
+            return digest[i] < target[i];
+        }
+    }
+    return true;
+}
+
+}
+
+#endif // SHA256KERNELS_H
@@ -0,0 +1,130 @@
+#ifndef SHA256LANES_H
+#define SHA256LANES_H
+#include <cstdint>
+#include "Sha256Kernels.h"
+
+// Общий многополосный SHA256d: Ops задаёт тип вектора и операции над 32-битными
+// полосами (AVX2 - 8 полос, AVX-512 - 16). Подключается только из файлов ядер.
+
+namespace sha256kernels {
+namespace {
+
+template <typename Ops>
+struct Lanes
+{
+    using Vec = typename Ops::Vec;
+
+    static inline Vec bigSigma0(Vec x) { return Ops::xor3(Ops::template rotr<2>(x), Ops::template rotr<13>(x), Ops::template rotr<22>(x)); }
+    static inline Vec bigSigma1(Vec x) { return Ops::xor3(Ops::template rotr<6>(x), Ops::template rotr<11>(x), Ops::template rotr<25>(x)); }
+    static inline Vec smallSigma0(Vec x) { return Ops::xor3(Ops::template rotr<7>(x), Ops::template rotr<18>(x), Ops::template shr<3>(x)); }
+    static inline Vec smallSigma1(Vec x) { return Ops::xor3(Ops::template rotr<17>(x), Ops::template rotr<19>(x), Ops::template shr<10>(x)); }
+
+    static inline Vec byteSwap(Vec x)
+    {
+        Vec b0 = Ops::template shl<24>(x);
+        Vec b1 = Ops::template shl<8>(Ops::bitAnd(x, Ops::set1(0x0000ff00u)));
+        Vec b2 = Ops::bitAnd(Ops::template shr<8>(x), Ops::set1(0x0000ff00u));
+        Vec b3 = Ops::template shr<24>(x);
+        return Ops::bitOr(Ops::bitOr(b0, b1), Ops::bitOr(b2, b3));
+    }
+
+    // 64 раунда сжатия над state, w - 16 слов сообщения (перезаписываются расписанием)
+    static inline void compress(Vec state[8], Vec w[16])
+    {
+        Vec a = state[0], b = state[1], c = state[2], d = state[3];
+        Vec e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int t = 0; t < 64; ++t)
+        {
+            if (t >= 16)
+            {
+                w[t & 15] = Ops::add(Ops::add(w[t & 15], smallSigma0(w[(t + 1) & 15])),
+                                     Ops::add(w[(t + 9) & 15], smallSigma1(w[(t + 14) & 15])));
+            }
+            Vec t1 = Ops::add(Ops::add(h, bigSigma1(e)),
+                              Ops::add(Ops::ch(e, f, g), Ops::add(Ops::set1(K[t]), w[t & 15])));
+            Vec t2 = Ops::add(bigSigma0(a), Ops::maj(a, b, c));
+            h = g; g = f; f = e; e = Ops::add(d, t1);
+            d = c; c = b; b = a; a = Ops::add(t1, t2);
+        }
+        state[0] = Ops::add(state[0], a); state[1] = Ops::add(state[1], b);
+        state[2] = Ops::add(state[2], c); state[3] = Ops::add(state[3], d);
+        state[4] = Ops::add(state[4], e); state[5] = Ops::add(state[5], f);
+        state[6] = Ops::add(state[6], g); state[7] = Ops::add(state[7], h);
+    }
+
+    static bool scan(const uint32_t midstate[8], const uint32_t tailWords[16], uint32_t firstNonce,
+                     uint32_t count, const uint32_t target[8], uint32_t* foundNonce)
+    {
+        alignas(64) uint32_t laneOffsets[Ops::LANES];
+        for (int i = 0; i < Ops::LANES; ++i)
+        {
+            laneOffsets[i] = static_cast<uint32_t>(i);
+        }
+        const Vec offsets = Ops::load(laneOffsets);
+
+        for (uint64_t done = 0; done < count; done += Ops::LANES)
+        {
+            const uint32_t base = firstNonce + static_cast<uint32_t>(done);
+            Vec w[16];
+            for (int i = 0; i < 16; ++i)
+            {
+                w[i] = Ops::set1(tailWords[i]);
+            }
+            w[NONCE_WORD] = byteSwap(Ops::add(Ops::set1(base), offsets)); // nonce лежит в заголовке little-endian
+
+            Vec inner[8];
+            for (int i = 0; i < 8; ++i)
+            {
+                inner[i] = Ops::set1(midstate[i]);
+            }
+            compress(inner, w);
+
+            // Второй SHA-256 над 32-байтовым дайджестом: один блок с фиксированным паддингом
+            Vec outer[8];
+            for (int i = 0; i < 8; ++i)
+            {
+                w[i] = inner[i];
+                outer[i] = Ops::set1(IV[i]);
+            }
+            w[8] = Ops::set1(0x80000000u);
+            for (int i = 9; i < 15; ++i)
+            {
+                w[i] = Ops::set1(0);
+            }
+            w[15] = Ops::set1(256);
+            compress(outer, w);
+
+            alignas(64) uint32_t firstWords[Ops::LANES];
+            Ops::store(firstWords, outer[0]);
+            uint64_t lanes = count - done < static_cast<uint64_t>(Ops::LANES) ? count - done : Ops::LANES;
+            for (uint64_t lane = 0; lane < lanes; ++lane)
+            {
+                if (firstWords[lane] > target[0])
+                {
+                    continue; // быстрый отсев по старшему слову
+                }
+                alignas(64) uint32_t words[8][Ops::LANES];
+                for (int i = 0; i < 8; ++i)
+                {
+                    Ops::store(words[i], outer[i]);
+                }
+                uint32_t digest[8];
+                for (int i = 0; i < 8; ++i)
+                {
+                    digest[i] = words[i][lane];
+                }
+                if (meetsTarget(digest, target))
+                {
+                    *foundNonce = base + static_cast<uint32_t>(lane);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+};
+
+}
+}
+
+#endif // SHA256LANES_H
@@ -0,0 +1,93 @@
+// Собирается с -msse4.1 -msha: аппаратные раунды SHA-256 (Intel SHA Extensions)
+#include <immintrin.h>
+#include "Sha256Kernels.h"
+
+namespace sha256kernels {
+namespace {
+
+// state в обычном порядке a..h, w - 16 слов сообщения
+inline void compress(uint32_t state[8], const uint32_t w[16])
+{
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0]));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4]));
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);           // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B);     // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8); // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);  // CDGH
+    const __m128i abefSave = state0;
+    const __m128i cdghSave = state1;
+
+    __m128i msg[4];
+    for (int i = 0; i < 16; ++i)
+    {
+        __m128i current;
+        if (i < 4)
+        {
+            current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&w[4 * i]));
+        }
+        else
+        {
+            // W[t..t+3] из W[t-16..t-13], W[t-15..], W[t-7..] и W[t-4..]
+            __m128i sum = _mm_add_epi32(_mm_sha256msg1_epu32(msg[i & 3], msg[(i + 1) & 3]),
+                                        _mm_alignr_epi8(msg[(i + 3) & 3], msg[(i + 2) & 3], 4));
+            current = _mm_sha256msg2_epu32(sum, msg[(i + 3) & 3]);
+        }
+        msg[i & 3] = current;
+        __m128i k = _mm_add_epi32(current, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&K[4 * i])));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, k);
+        k = _mm_shuffle_epi32(k, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, k);
+    }
+
+    state0 = _mm_add_epi32(state0, abefSave);
+    state1 = _mm_add_epi32(state1, cdghSave);
+    tmp = _mm_shuffle_epi32(state0, 0x1B);        // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);     // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);  // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);     // HGFE
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+
+}
+
+bool scanShaNi(const uint32_t midstate[8], const uint32_t tailWords[16], uint32_t firstNonce,
+               uint32_t count, const uint32_t target[8], uint32_t* foundNonce)
+{
+    uint32_t w[16];
+    for (int i = 0; i < 16; ++i)
+    {
+        w[i] = tailWords[i];
+    }
+    uint32_t outerBlock[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0x80000000u, 0, 0, 0, 0, 0, 0, 256};
+
+    for (uint64_t done = 0; done < count; ++done)
+    {
+        const uint32_t nonce = firstNonce + static_cast<uint32_t>(done);
+        w[NONCE_WORD] = __builtin_bswap32(nonce); // nonce лежит в заголовке little-endian
+
+        uint32_t inner[8];
+        for (int i = 0; i < 8; ++i)
+        {
+            inner[i] = midstate[i];
+        }
+        compress(inner, w);
+
+        uint32_t outer[8];
+        for (int i = 0; i < 8; ++i)
+        {
+            outerBlock[i] = inner[i];
+            outer[i] = IV[i];
+        }
+        compress(outer, outerBlock);
+
+        if (outer[0] <= target[0] && meetsTarget(outer, target))
+        {
+            *foundNonce = nonce;
+            return true;
+        }
+    }
+    return false;
+}
+
+}
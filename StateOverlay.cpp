@@ -0,0 +1,79 @@
+#include "StateOverlay.h"
+
+StateOverlay::StateOverlay(StateStore& base) : base(base)
+{
+}
+
+int64_t StateOverlay::get(std::string_view key) const
+{
+    const uint32_t id = base.keyId(key);
+    if (id == KeyInterner::NOT_FOUND)
+    {
+        return 0;
+    }
+    auto it = positions.find(id);
+    if (it != positions.end())
+    {
+        return writes[it->second].value;
+    }
+    int64_t value = 0;
+    base.findById(id, value);
+    return value;
+}
+
+void StateOverlay::set(std::string_view key, int64_t value)
+{
+    slot(base.internKey(key)) = value;
+}
+
+void StateOverlay::add(std::string_view key, int64_t delta)
+{
+    slot(base.internKey(key)) += delta;
+}
+
+int64_t& StateOverlay::slot(uint32_t id)
+{
+    auto it = positions.find(id);
+    if (it != positions.end())
+    {
+        journal.push_back({it->second, false, writes[it->second].value});
+        return writes[it->second].value;
+    }
+    int64_t value = 0;
+    base.findById(id, value);
+    const uint32_t position = static_cast<uint32_t>(writes.size());
+    positions.emplace(id, position);
+    writes.push_back({id, value});
+    journal.push_back({position, true, 0});
+    return writes.back().value;
+}
+
+void StateOverlay::revertTo(size_t checkpoint)
+{
+    while (journal.size() > checkpoint)
+    {
+        const UndoEntry& undo = journal.back();
+        if (undo.created)
+        {
+            // Созданные записи разматываются в обратном порядке, поэтому это всегда последняя
+            positions.erase(writes[undo.position].id);
+            writes.pop_back();
+        }
+        else
+        {
+            writes[undo.position].value = undo.previous;
+        }
+        journal.pop_back();
+    }
+}
+
+void StateOverlay::commit()
+{
+    for (const Write& write : writes)
+    {
+        base.valueById(write.id) = write.value;
+    }
+    writes.clear();
+    positions.clear();
+    journal.clear();
+}
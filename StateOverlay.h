@@ -0,0 +1,55 @@
+#ifndef STATEOVERLAY_H
+#define STATEOVERLAY_H
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "StateStore.h"
+#include "StateView.h"
+
+// Журналируемый слой изменений поверх StateStore.
+// Записи копятся в дельте (только затронутые ключи), чтение смотрит сначала в дельту,
+// потом в базу. commit() переносит дельту в базу, discard() её выбрасывает.
+// checkpoint()/revertTo() дают вложенные точки отката: каждая запись в дельту
+// журналируется, откат разматывает журнал до метки. Все операции стоят
+// O(затронутых ключей), а не O(размера состояния).
+class StateOverlay : public StateView
+{
+public:
+    explicit StateOverlay(StateStore& base);
+    StateOverlay(const StateOverlay&) = delete;
+    StateOverlay& operator=(const StateOverlay&) = delete;
+
+    int64_t get(std::string_view key) const override; // 0 для отсутствующего ключа
+    void set(std::string_view key, int64_t value) override;
+    void add(std::string_view key, int64_t delta) override;
+
+    size_t checkpoint() const override { return journal.size(); } // метка для revertTo
+    void revertTo(size_t checkpoint) override;
+    void commit();
+    void discard() { revertTo(0); }
+    size_t touchedKeys() const { return writes.size(); }
+
+private:
+    struct Write
+    {
+        uint32_t id;
+        int64_t value;
+    };
+    struct UndoEntry
+    {
+        uint32_t position; // индекс в writes
+        bool created;      // ключ впервые попал в дельту этой записью
+        int64_t previous;
+    };
+
+    StateStore& base;
+    std::vector<Write> writes; // в порядке первого касания
+    std::unordered_map<uint32_t, uint32_t> positions; // id ключа -> индекс в writes
+    std::vector<UndoEntry> journal;
+
+    int64_t& slot(uint32_t id);
+};
+
+#endif // STATEOVERLAY_H
@@ -0,0 +1,240 @@
+#include "StateSnapshot.h"
+#include "Crc32.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint64_t SNAPSHOT_MAGIC = 0x31305041534e5453ull; // "STSNAP01"
+constexpr size_t BUFFER_SIZE = 64 * 1024;
+constexpr uint32_t MAX_KEY_LENGTH = 1u << 20;
+
+std::string snapshotName(uint64_t height)
+{
+    return "state_" + std::to_string(height) + ".snap";
+}
+
+// Буферизованная запись в fd с подсчётом CRC на лету
+class SnapshotWriter
+{
+public:
+    explicit SnapshotWriter(int fd) : fd(fd), crc(0) { buffer.reserve(BUFFER_SIZE); }
+
+    void writeLE(uint64_t value, int bytes)
+    {
+        uint8_t raw[8];
+        for (int i = 0; i < bytes; ++i)
+        {
+            raw[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+        write(raw, bytes);
+    }
+
+    void write(const uint8_t* data, size_t length)
+    {
+        crc = crc32Update(crc, data, length);
+        buffer.insert(buffer.end(), data, data + length);
+        if (buffer.size() >= BUFFER_SIZE)
+        {
+            flush();
+        }
+    }
+
+    void finish()
+    {
+        writeLE(crc, 4);
+        flush();
+    }
+
+private:
+    void flush()
+    {
+        size_t done = 0;
+        while (done < buffer.size())
+        {
+            ssize_t written = ::write(fd, buffer.data() + done, buffer.size() - done);
+            if (written < 0)
+            {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("Failed to write state snapshot: " + std::string(std::strerror(errno)));
+            }
+            done += static_cast<size_t>(written);
+        }
+        buffer.clear();
+    }
+
+    int fd;
+    uint32_t crc;
+    std::vector<uint8_t> buffer;
+};
+
+// Буферизованное чтение с CRC; false при обрыве файла
+class SnapshotReader
+{
+public:
+    explicit SnapshotReader(std::FILE* file) : file(file), crc(0) {}
+
+    bool readLE(uint64_t& value, int bytes)
+    {
+        uint8_t raw[8];
+        if (!read(raw, bytes))
+        {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < bytes; ++i)
+        {
+            value |= uint64_t(raw[i]) << (8 * i);
+        }
+        return true;
+    }
+
+    bool read(uint8_t* data, size_t length)
+    {
+        if (std::fread(data, 1, length, file) != length)
+        {
+            return false;
+        }
+        crc = crc32Update(crc, data, length);
+        return true;
+    }
+
+    // Трейлер не входит в CRC
+    bool verifyTrailer()
+    {
+        uint32_t expected = crc;
+        uint8_t raw[4];
+        if (std::fread(raw, 1, sizeof(raw), file) != sizeof(raw))
+        {
+            return false;
+        }
+        uint32_t stored = uint32_t(raw[0]) | (uint32_t(raw[1]) << 8) | (uint32_t(raw[2]) << 16) | (uint32_t(raw[3]) << 24);
+        return stored == expected && std::fgetc(file) == EOF;
+    }
+
+private:
+    std::FILE* file;
+    uint32_t crc;
+};
+
+}
+
+std::string StateSnapshot::write(const std::string& directory, uint64_t height, const Hash256& tipHash, const State& state)
+{
+    std::filesystem::create_directories(directory);
+    const std::string path = directory + "/" + snapshotName(height);
+    const std::string tmpPath = path + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to create state snapshot " + tmpPath + ": " + std::strerror(errno));
+    }
+    try
+    {
+        SnapshotWriter writer(fd);
+        writer.writeLE(SNAPSHOT_MAGIC, 8);
+        writer.writeLE(height, 8);
+        writer.write(tipHash.data(), Hash256::SIZE);
+        writer.writeLE(state.size(), 8);
+        state.forEach([&writer](const std::string& key, int64_t value) {
+            writer.writeLE(key.size(), 4);
+            writer.write(reinterpret_cast<const uint8_t*>(key.data()), key.size());
+            writer.writeLE(static_cast<uint64_t>(value), 8);
+        });
+        writer.finish();
+        if (::fsync(fd) != 0)
+        {
+            throw std::runtime_error("Failed to sync state snapshot: " + std::string(std::strerror(errno)));
+        }
+    }
+    catch (...)
+    {
+        ::close(fd);
+        std::remove(tmpPath.c_str());
+        throw;
+    }
+    ::close(fd);
+    std::filesystem::rename(tmpPath, path);
+    return path;
+}
+
+bool StateSnapshot::load(const std::string& path, uint64_t& height, Hash256& tipHash, State& state)
+{
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        return false;
+    }
+    std::setvbuf(file, nullptr, _IOFBF, BUFFER_SIZE);
+    SnapshotReader reader(file);
+    State loaded;
+    uint64_t magic = 0;
+    uint64_t loadedHeight = 0;
+    uint64_t count = 0;
+    HashBytes hash;
+    bool ok = reader.readLE(magic, 8) && magic == SNAPSHOT_MAGIC && reader.readLE(loadedHeight, 8)
+              && reader.read(hash.data(), hash.size()) && reader.readLE(count, 8);
+    std::string key;
+    for (uint64_t i = 0; ok && i < count; ++i)
+    {
+        uint64_t keyLength = 0;
+        uint64_t value = 0;
+        ok = reader.readLE(keyLength, 4) && keyLength <= MAX_KEY_LENGTH;
+        if (ok)
+        {
+            key.resize(keyLength);
+            ok = reader.read(reinterpret_cast<uint8_t*>(&key[0]), keyLength) && reader.readLE(value, 8);
+        }
+        if (ok)
+        {
+            loaded[key] = static_cast<int64_t>(value);
+        }
+    }
+    ok = ok && reader.verifyTrailer();
+    std::fclose(file);
+    if (!ok)
+    {
+        Logger::getInstance().log("State snapshot " + path + " is corrupted, skipping");
+        return false;
+    }
+    height = loadedHeight;
+    tipHash = Hash256(hash);
+    state = std::move(loaded);
+    return true;
+}
+
+std::vector<std::pair<uint64_t, std::string>> StateSnapshot::list(const std::string& directory)
+{
+    std::vector<std::pair<uint64_t, std::string>> snapshots;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+    {
+        const std::string name = entry.path().filename().string();
+        unsigned long long height = 0;
+        int consumed = 0;
+        if (std::sscanf(name.c_str(), "state_%llu.snap%n", &height, &consumed) == 1
+            && static_cast<size_t>(consumed) == name.size())
+        {
+            snapshots.emplace_back(height, entry.path().string());
+        }
+    }
+    std::sort(snapshots.begin(), snapshots.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    return snapshots;
+}
+
+void StateSnapshot::prune(const std::string& directory, size_t keep)
+{
+    auto snapshots = list(directory);
+    for (size_t i = keep; i < snapshots.size(); ++i)
+    {
+        std::error_code error;
+        std::filesystem::remove(snapshots[i].second, error);
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef STATESNAPSHOT_H
+#define STATESNAPSHOT_H
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Hash256.h"
+#include "StateStore.h"
+
+// Снимок globalState после блока height в файле state_<height>.snap.
+// Ключи пишутся в порядке StateStore::forEach (порядок первого появления),
+// при загрузке они интернируются в том же порядке.
+// Формат (little-endian), пишется и читается потоково:
+//   magic "STSNAP01" | height u64 | tipHash 32 | count u64 |
+//   count x (длина ключа u32 | ключ | значение i64) | CRC32 всего предыдущего
+// Запись идёт во временный файл, затем fsync и rename - на диске либо старый снимок,
+// либо новый целиком.
+class StateSnapshot
+{
+public:
+    using State = StateStore;
+
+    static std::string write(const std::string& directory, uint64_t height, const Hash256& tipHash, const State& state);
+    // false, если файл повреждён (CRC, обрыв); state при этом не меняется
+    static bool load(const std::string& path, uint64_t& height, Hash256& tipHash, State& state);
+    // (высота, путь) всех снимков в каталоге, от новых к старым
+    static std::vector<std::pair<uint64_t, std::string>> list(const std::string& directory);
+    static void prune(const std::string& directory, size_t keep); // удаляет всё, кроме keep последних
+};
+
+#endif // STATESNAPSHOT_H
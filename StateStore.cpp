@@ -0,0 +1,239 @@
+#include "StateStore.h"
+#include <functional>
+#include <stdexcept>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr size_t INITIAL_CAPACITY = 64; // слотов, кратно размеру группы
+
+// Битовая маска байтов группы, равных tag
+inline uint32_t matchGroup(const int8_t* group, int8_t tag)
+{
+#if defined(__SSE2__)
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(tag))));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        mask |= uint32_t(group[i] == tag) << i;
+    }
+    return mask;
+#endif
+}
+
+// Номер младшего установленного бита маски; mask != 0
+inline uint32_t lowestBit(uint32_t mask)
+{
+#if defined(__GNUC__)
+    return static_cast<uint32_t>(__builtin_ctz(mask));
+#else
+    uint32_t index = 0;
+    for (; (mask & 1) == 0; mask >>= 1)
+    {
+        ++index;
+    }
+    return index;
+#endif
+}
+
+inline int8_t tagOf(size_t hash)
+{
+    return static_cast<int8_t>(hash & 0x7f);
+}
+
+}
+
+KeyInterner::KeyInterner()
+    : control(INITIAL_CAPACITY, EMPTY), slots(INITIAL_CAPACITY, 0), count(0)
+{
+}
+
+uint32_t KeyInterner::probe(std::string_view key, size_t hash, size_t& freeSlot) const
+{
+    const size_t groupMask = control.size() / GROUP_SIZE - 1;
+    const int8_t tag = tagOf(hash);
+    size_t group = (hash >> 7) & groupMask;
+    // Треугольные шаги по группам: при числе групп - степени двойки обходятся все
+    for (size_t step = 1;; ++step)
+    {
+        const size_t base = group * GROUP_SIZE;
+        for (uint32_t matches = matchGroup(&control[base], tag); matches != 0; matches &= matches - 1)
+        {
+            const uint32_t id = slots[base + lowestBit(matches)];
+            if (keyHashes[id] == hash && name(id) == key)
+            {
+                return id;
+            }
+        }
+        const uint32_t empty = matchGroup(&control[base], EMPTY);
+        if (empty != 0)
+        {
+            freeSlot = base + lowestBit(empty);
+            return NOT_FOUND;
+        }
+        group = (group + step) & groupMask;
+    }
+}
+
+uint32_t KeyInterner::find(std::string_view key) const
+{
+    size_t freeSlot;
+    return probe(key, std::hash<std::string_view>()(key), freeSlot);
+}
+
+uint32_t KeyInterner::intern(std::string_view key)
+{
+    const size_t hash = std::hash<std::string_view>()(key);
+    size_t freeSlot;
+    uint32_t id = probe(key, hash, freeSlot);
+    if (id != NOT_FOUND)
+    {
+        return id;
+    }
+    id = count.load(std::memory_order_relaxed);
+    if (id >= MAX_CHUNKS * CHUNK_SIZE)
+    {
+        throw std::runtime_error("State key limit exceeded");
+    }
+    if ((id & (CHUNK_SIZE - 1)) == 0)
+    {
+        chunks[id >> CHUNK_BITS].reset(new std::string[CHUNK_SIZE]);
+    }
+    chunks[id >> CHUNK_BITS][id & (CHUNK_SIZE - 1)] = std::string(key);
+    keyHashes.push_back(hash);
+    if (8 * (size_t(id) + 1) > 7 * control.size())
+    {
+        grow(); // заполнение не выше 7/8: в каждой цепочке проб есть пустой слот
+        probe(key, hash, freeSlot);
+    }
+    control[freeSlot] = tagOf(hash);
+    slots[freeSlot] = id;
+    count.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+const std::string& KeyInterner::name(uint32_t id) const
+{
+    return chunks[id >> CHUNK_BITS][id & (CHUNK_SIZE - 1)];
+}
+
+void KeyInterner::grow()
+{
+    const size_t capacity = control.size() * 2;
+    control.assign(capacity, EMPTY);
+    slots.assign(capacity, 0);
+    const size_t groupMask = capacity / GROUP_SIZE - 1;
+    const uint32_t known = count.load(std::memory_order_relaxed);
+    for (uint32_t id = 0; id < known; ++id)
+    {
+        const size_t hash = keyHashes[id];
+        size_t group = (hash >> 7) & groupMask;
+        for (size_t step = 1;; ++step)
+        {
+            const uint32_t empty = matchGroup(&control[group * GROUP_SIZE], EMPTY);
+            if (empty != 0)
+            {
+                const size_t slot = group * GROUP_SIZE + lowestBit(empty);
+                control[slot] = tagOf(hash);
+                slots[slot] = id;
+                break;
+            }
+            group = (group + step) & groupMask;
+        }
+    }
+}
+
+StateStore::StateStore() : interner(std::make_shared<KeyInterner>())
+{
+}
+
+StateStore::StateStore(std::shared_ptr<KeyInterner> interner) : interner(std::move(interner))
+{
+}
+
+bool StateStore::find(std::string_view key, int64_t& value) const
+{
+    return findById(interner->find(key), value);
+}
+
+bool StateStore::findById(uint32_t id, int64_t& value) const
+{
+    if (id >= values.size() || !present[id])
+    {
+        return false;
+    }
+    value = values[id];
+    return true;
+}
+
+int64_t StateStore::get(std::string_view key) const
+{
+    int64_t value = 0;
+    find(key, value);
+    return value;
+}
+
+int64_t& StateStore::operator[](std::string_view key)
+{
+    return valueById(interner->intern(key));
+}
+
+int64_t& StateStore::valueById(uint32_t id)
+{
+    if (id >= values.size())
+    {
+        values.resize(size_t(id) + 1, 0);
+        present.resize(size_t(id) + 1, 0);
+        touchedMark.resize(size_t(id) + 1, 0);
+    }
+    touch(id);
+    if (!present[id])
+    {
+        present[id] = 1;
+        values[id] = 0;
+        ++count;
+    }
+    return values[id];
+}
+
+void StateStore::erase(std::string_view key)
+{
+    const uint32_t id = interner->find(key);
+    if (id >= values.size() || !present[id])
+    {
+        return;
+    }
+    touch(id);
+    present[id] = 0;
+    values[id] = 0;
+    --count;
+}
+
+void StateStore::touch(uint32_t id)
+{
+    if (!touchedMark[id])
+    {
+        touchedMark[id] = 1;
+        touched.push_back({id, present[id] != 0, values[id]});
+    }
+}
+
+void StateStore::clear()
+{
+    values.clear();
+    present.clear();
+    touched.clear();
+    touchedMark.clear();
+    count = 0;
+}
+
+std::map<std::string, int64_t> StateStore::toMap() const
+{
+    std::map<std::string, int64_t> result;
+    forEach([&result](const std::string& key, int64_t value) { result.emplace(key, value); });
+    return result;
+}
@@ -0,0 +1,129 @@
+#ifndef STATESTORE_H
+#define STATESTORE_H
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Словарь имён ключей состояния -> плотные 32-битные id.
+// Таблица - открытая адресация с контрольными байтами: на каждый слот байт с 7 битами хэша
+// (или EMPTY), группа из 16 байт сравнивается с искомым тегом одной SSE2-инструкцией,
+// строки сравниваются только у совпавших тегов. Удалений нет, поэтому нет и надгробий.
+//
+// find/intern вызывает один писатель (под chainMutex). name(id) для уже выданного id
+// можно звать из других потоков: строки лежат в чанках, которые не переезжают.
+class KeyInterner
+{
+public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    KeyInterner();
+    KeyInterner(const KeyInterner&) = delete;
+    KeyInterner& operator=(const KeyInterner&) = delete;
+
+    uint32_t find(std::string_view key) const; // NOT_FOUND, если ключ не встречался
+    uint32_t intern(std::string_view key);
+    const std::string& name(uint32_t id) const;
+    uint32_t size() const { return count.load(std::memory_order_acquire); }
+
+private:
+    static constexpr size_t GROUP_SIZE = 16;
+    static constexpr int8_t EMPTY = -128;
+    static constexpr uint32_t CHUNK_BITS = 12;
+    static constexpr uint32_t CHUNK_SIZE = 1u << CHUNK_BITS;
+    static constexpr size_t MAX_CHUNKS = 4096; // до 16M ключей
+
+    std::vector<int8_t> control; // тег слота: 7 младших бит хэша или EMPTY
+    std::vector<uint32_t> slots; // id ключа в слоте
+    std::vector<size_t> keyHashes; // хэш по id, чтобы при росте не хэшировать строки заново
+    std::array<std::unique_ptr<std::string[]>, MAX_CHUNKS> chunks;
+    std::atomic<uint32_t> count;
+
+    uint32_t probe(std::string_view key, size_t hash, size_t& freeSlot) const;
+    void grow();
+};
+
+// Состояние аккаунтов и хранилища контрактов: ключ -> int64.
+// Значения лежат в плотном массиве по id ключа, поэтому после интернирования чтение и запись -
+// индексация массива; копия - два memcpy, словарь ключей общий у всех копий.
+// forEach обходит ключи в порядке их первого появления - он одинаков при повторе той же
+// истории, так что снимки детерминированы.
+class StateStore
+{
+public:
+    StateStore();
+    explicit StateStore(std::shared_ptr<KeyInterner> interner);
+
+    bool find(std::string_view key, int64_t& value) const;
+    int64_t get(std::string_view key) const; // 0 для отсутствующего ключа
+    int64_t& operator[](std::string_view key); // создаёт ключ со значением 0, как std::map
+    void set(std::string_view key, int64_t value) { (*this)[key] = value; }
+    void erase(std::string_view key); // для отката блока: ключ, созданный блоком, исчезает
+
+    // Доступ по id ключа - для слоёв поверх хранилища (StateOverlay)
+    uint32_t keyId(std::string_view key) const { return interner->find(key); } // KeyInterner::NOT_FOUND
+    uint32_t internKey(std::string_view key) { return interner->intern(key); }
+    bool findById(uint32_t id, int64_t& value) const;
+    int64_t& valueById(uint32_t id); // создаёт ключ со значением 0
+    size_t size() const { return count; }
+    void clear();
+    const std::shared_ptr<KeyInterner>& keys() const { return interner; }
+
+    template <typename Visitor>
+    void forEach(Visitor&& visitor) const
+    {
+        for (uint32_t id = 0; id < values.size(); ++id)
+        {
+            if (present[id])
+            {
+                visitor(interner->name(id), values[id]);
+            }
+        }
+    }
+    std::map<std::string, int64_t> toMap() const;
+
+    // Изменение ключа с прошлого drainTouched: текущее значение и то, что было до первой записи
+    struct Change
+    {
+        const std::string& key;
+        bool present;     // false - ключ удалён (erase)
+        int64_t value;
+        bool existed;     // был ли ключ до первой записи
+        int64_t previous;
+    };
+    // Ключи, записанные через valueById/operator[]/erase с прошлого вызова, - для инкрементального
+    // StateTree, версий для читателей и undo-логов. Каждый ключ отдаётся один раз.
+    template <typename Visitor>
+    void drainTouched(Visitor&& visitor)
+    {
+        for (const Touch& touch : touched)
+        {
+            touchedMark[touch.id] = 0;
+            visitor(Change{interner->name(touch.id), present[touch.id] != 0, values[touch.id], touch.existed, touch.previous});
+        }
+        touched.clear();
+    }
+
+private:
+    std::shared_ptr<KeyInterner> interner;
+    std::vector<int64_t> values; // по id ключа
+    std::vector<uint8_t> present;
+    struct Touch
+    {
+        uint32_t id;
+        bool existed;
+        int64_t previous;
+    };
+    std::vector<Touch> touched; // в порядке первой записи
+    std::vector<uint8_t> touchedMark;
+
+    void touch(uint32_t id);
+    size_t count = 0;
+};
+
+#endif // STATESTORE_H
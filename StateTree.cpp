@@ -0,0 +1,210 @@
+#include "StateTree.h"
+#include <algorithm>
+#include <string>
+#include <openssl/sha.h>
+
+namespace {
+
+inline int bitAt(const HashBytes& path, uint16_t bit)
+{
+    return (path[bit >> 3] >> (7 - (bit & 7))) & 1;
+}
+
+// Номер старшего различающегося бита байта, считая от старшего; diff != 0
+inline uint16_t firstDifferentBit(uint8_t diff)
+{
+#if defined(__GNUC__)
+    return static_cast<uint16_t>(__builtin_clz(uint32_t(diff)) - 24);
+#else
+    uint16_t bit = 0;
+    for (uint8_t mask = 0x80; (diff & mask) == 0; mask >>= 1)
+    {
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+}
+
+uint32_t StateTree::addLeaf(const HashBytes& path, int64_t value)
+{
+    Node leaf;
+    leaf.path = path;
+    leaf.value = value;
+    nodes.push_back(leaf);
+    ++leaves;
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void StateTree::update(std::string_view key, int64_t value)
+{
+    HashBytes path;
+    SHA256(reinterpret_cast<const unsigned char*>(key.data()), key.size(), path.data());
+    if (rootNode == NONE)
+    {
+        rootNode = addLeaf(path, value);
+        return;
+    }
+
+    // Ближайший лист по битам нового пути: с ним новый ключ делит самый длинный префикс
+    uint32_t nearest = rootNode;
+    while (!nodes[nearest].isLeaf())
+    {
+        nearest = nodes[nearest].child[bitAt(path, nodes[nearest].bit)];
+    }
+    const HashBytes& nearestPath = nodes[nearest].path;
+    size_t byte = 0;
+    while (byte < path.size() && path[byte] == nearestPath[byte])
+    {
+        ++byte;
+    }
+
+    if (byte == path.size())
+    {
+        // Ключ уже в дереве: меняется лист и его предки
+        if (nodes[nearest].value == value)
+        {
+            return;
+        }
+        nodes[nearest].value = value;
+        for (uint32_t index = rootNode;; index = nodes[index].child[bitAt(path, nodes[index].bit)])
+        {
+            nodes[index].dirty = true;
+            if (nodes[index].isLeaf())
+            {
+                break;
+            }
+        }
+        return;
+    }
+
+    const uint16_t critBit = static_cast<uint16_t>(8 * byte + firstDifferentBit(path[byte] ^ nearestPath[byte]));
+    const uint32_t leaf = addLeaf(path, value);
+    const uint32_t fork = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+    nodes[fork].bit = critBit;
+
+    // Развилка встаёт ниже всех узлов с меньшим номером бита; они и есть грязный путь
+    uint32_t parent = NONE;
+    int side = 0;
+    uint32_t current = rootNode;
+    while (!nodes[current].isLeaf() && nodes[current].bit < critBit)
+    {
+        nodes[current].dirty = true;
+        parent = current;
+        side = bitAt(path, nodes[current].bit);
+        current = nodes[current].child[side];
+    }
+    const int newSide = bitAt(path, critBit);
+    nodes[fork].child[newSide] = leaf;
+    nodes[fork].child[1 - newSide] = current;
+    if (parent == NONE)
+    {
+        rootNode = fork;
+    }
+    else
+    {
+        nodes[parent].child[side] = fork;
+    }
+}
+
+void StateTree::erase(std::string_view key)
+{
+    HashBytes path;
+    SHA256(reinterpret_cast<const unsigned char*>(key.data()), key.size(), path.data());
+    uint32_t grandparent = NONE;
+    uint32_t parent = NONE;
+    int parentSide = 0;
+    int side = 0;
+    uint32_t current = rootNode;
+    while (current != NONE && !nodes[current].isLeaf())
+    {
+        grandparent = parent;
+        parentSide = side;
+        parent = current;
+        side = bitAt(path, nodes[current].bit);
+        current = nodes[current].child[side];
+    }
+    if (current == NONE || nodes[current].path != path)
+    {
+        return;
+    }
+    --leaves;
+    if (parent == NONE)
+    {
+        rootNode = NONE;
+        return;
+    }
+    // Развилка над листом больше не нужна: её место занимает второй потомок
+    const uint32_t sibling = nodes[parent].child[1 - side];
+    if (grandparent == NONE)
+    {
+        rootNode = sibling;
+    }
+    else
+    {
+        nodes[grandparent].child[parentSide] = sibling;
+        for (uint32_t index = rootNode; index != sibling; index = nodes[index].child[bitAt(path, nodes[index].bit)])
+        {
+            nodes[index].dirty = true;
+        }
+    }
+}
+
+void StateTree::rebuild(const StateStore& state)
+{
+    nodes.clear();
+    rootNode = NONE;
+    leaves = 0;
+    state.forEach([this](const std::string& key, int64_t value) { update(key, value); });
+}
+
+const HashBytes& StateTree::root()
+{
+    if (rootNode == NONE)
+    {
+        rootHash.fill(0);
+    }
+    else
+    {
+        rootHash = rehash(rootNode);
+    }
+    return rootHash;
+}
+
+const HashBytes& StateTree::rehash(uint32_t index)
+{
+    Node& node = nodes[index]; // при пересчёте узлы не добавляются, ссылка стабильна
+    if (!node.dirty)
+    {
+        return node.hash;
+    }
+    // Лист: 0x00 | путь | значение LE; внутренний узел: 0x01 | бит LE | левый | правый
+    uint8_t buffer[3 + 2 * 32];
+    size_t length;
+    if (node.isLeaf())
+    {
+        buffer[0] = 0x00;
+        std::copy(node.path.begin(), node.path.end(), buffer + 1);
+        for (int i = 0; i < 8; ++i)
+        {
+            buffer[33 + i] = static_cast<uint8_t>(static_cast<uint64_t>(node.value) >> (8 * i));
+        }
+        length = 41;
+    }
+    else
+    {
+        buffer[0] = 0x01;
+        buffer[1] = static_cast<uint8_t>(node.bit);
+        buffer[2] = static_cast<uint8_t>(node.bit >> 8);
+        const HashBytes& left = rehash(node.child[0]);
+        std::copy(left.begin(), left.end(), buffer + 3);
+        const HashBytes& right = rehash(node.child[1]);
+        std::copy(right.begin(), right.end(), buffer + 35);
+        length = sizeof(buffer);
+    }
+    SHA256(buffer, length, node.hash.data());
+    node.dirty = false;
+    return node.hash;
+}
@@ -0,0 +1,51 @@
+#ifndef STATETREE_H
+#define STATETREE_H
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "Hash256.h"
+#include "StateStore.h"
+
+// Разреженное дерево Меркла над состоянием: путь к листу - биты SHA256(ключа),
+// лист хэширует путь и значение. Цепочки из одного потомка сжаты (внутренний узел хранит
+// номер бита развилки, как в crit-bit дереве), поэтому глубина ~log2(N), а форма дерева
+// зависит только от набора ключей, а не от порядка вставки.
+//
+// update() меняет лист и помечает грязным путь от корня, root() пересчитывает только
+// грязные узлы: после блока это O(затронутых ключей * log N) хэшей.
+// Пустое дерево - нулевой корень. erase() нужен только откату блоков и редок, поэтому
+// освободившиеся узлы не переиспользуются.
+class StateTree
+{
+public:
+    void update(std::string_view key, int64_t value);
+    void erase(std::string_view key);
+    void rebuild(const StateStore& state); // заново по всему состоянию (после загрузки снимка)
+    const HashBytes& root();
+    size_t size() const { return leaves; }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+    struct Node
+    {
+        HashBytes path{};             // только у листа: SHA256(ключа)
+        HashBytes hash{};
+        int64_t value = 0;            // только у листа
+        uint32_t child[2] = {NONE, NONE};
+        uint16_t bit = 0;             // внутренний узел: бит развилки, 0 - старший бит path[0]
+        bool dirty = true;
+
+        bool isLeaf() const { return child[0] == NONE; }
+    };
+
+    std::vector<Node> nodes;
+    uint32_t rootNode = NONE;
+    size_t leaves = 0;
+    HashBytes rootHash{};
+
+    uint32_t addLeaf(const HashBytes& path, int64_t value);
+    const HashBytes& rehash(uint32_t index);
+};
+
+#endif // STATETREE_H
@@ -0,0 +1,226 @@
+#include "StateVersion.h"
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+
+namespace {
+
+std::atomic<uint64_t> nextEdit{1};
+
+inline uint32_t slotBit(size_t hash, unsigned shift)
+{
+    return 1u << ((hash >> shift) & 31);
+}
+
+inline size_t slotPosition(uint32_t bitmap, uint32_t bit)
+{
+    const uint32_t lower = bitmap & (bit - 1);
+#if defined(__GNUC__)
+    return static_cast<size_t>(__builtin_popcount(lower));
+#else
+    size_t count = 0;
+    for (uint32_t rest = lower; rest != 0; rest &= rest - 1)
+    {
+        ++count;
+    }
+    return count;
+#endif
+}
+
+}
+
+StateVersion::StateVersion() : root(std::make_shared<Node>())
+{
+}
+
+bool StateVersion::find(std::string_view key, int64_t& value) const
+{
+    const size_t hash = std::hash<std::string_view>()(key);
+    const Node* node = root.get();
+    for (unsigned shift = 0;; shift += BITS)
+    {
+        if (shift >= HASH_BITS)
+        {
+            for (const Entry& entry : node->entries)
+            {
+                if (*entry.key == key)
+                {
+                    value = entry.value;
+                    return true;
+                }
+            }
+            return false;
+        }
+        const uint32_t bit = slotBit(hash, shift);
+        if ((node->bitmap & bit) == 0)
+        {
+            return false;
+        }
+        const Entry& entry = node->entries[slotPosition(node->bitmap, bit)];
+        if (entry.child)
+        {
+            node = entry.child.get();
+            continue;
+        }
+        if (entry.hash == hash && *entry.key == key)
+        {
+            value = entry.value;
+            return true;
+        }
+        return false;
+    }
+}
+
+int64_t StateVersion::get(std::string_view key) const
+{
+    int64_t value = 0;
+    find(key, value);
+    return value;
+}
+
+std::map<std::string, int64_t> StateVersion::toMap() const
+{
+    std::map<std::string, int64_t> result;
+    forEach([&result](const std::string& key, int64_t value) { result.emplace(key, value); });
+    return result;
+}
+
+StateVersion::Builder::Builder(std::shared_ptr<const StateVersion> base, std::shared_ptr<const KeyInterner> keys)
+    : version(std::make_shared<StateVersion>()), edit(nextEdit.fetch_add(1))
+{
+    if (base)
+    {
+        if (base->count > 0 && base->keys != keys)
+        {
+            throw std::invalid_argument("State version is built over a different key interner");
+        }
+        version->root = base->root;
+        version->count = base->count;
+    }
+    version->keys = std::move(keys);
+}
+
+std::shared_ptr<StateVersion::Node> StateVersion::Builder::editable(const std::shared_ptr<Node>& node) const
+{
+    if (node->edit == edit)
+    {
+        return node;
+    }
+    auto copy = std::make_shared<Node>(*node);
+    copy->edit = edit;
+    return copy;
+}
+
+void StateVersion::Builder::set(const std::string& key, int64_t value)
+{
+    if (!version)
+    {
+        throw std::logic_error("State version builder was already published");
+    }
+    const size_t hash = std::hash<std::string_view>()(key);
+    version->root = editable(version->root);
+    Node* node = version->root.get();
+    for (unsigned shift = 0;; shift += BITS)
+    {
+        if (shift >= HASH_BITS)
+        {
+            // Полная коллизия хэшей: ключи лежат списком
+            for (Entry& entry : node->entries)
+            {
+                if (*entry.key == key)
+                {
+                    entry.value = value;
+                    return;
+                }
+            }
+            node->entries.push_back({hash, &key, value, nullptr});
+            ++version->count;
+            return;
+        }
+        const uint32_t bit = slotBit(hash, shift);
+        const size_t position = slotPosition(node->bitmap, bit);
+        if ((node->bitmap & bit) == 0)
+        {
+            node->entries.insert(node->entries.begin() + position, Entry{hash, &key, value, nullptr});
+            node->bitmap |= bit;
+            ++version->count;
+            return;
+        }
+        Entry& entry = node->entries[position];
+        if (entry.child)
+        {
+            entry.child = editable(entry.child);
+            node = entry.child.get();
+            continue;
+        }
+        if (entry.key == &key || (entry.hash == hash && *entry.key == key))
+        {
+            entry.value = value;
+            return;
+        }
+        // В слоте другой ключ: он уходит на уровень ниже, новый ключ ищет место там же
+        auto child = std::make_shared<Node>();
+        child->edit = edit;
+        if (shift + BITS < HASH_BITS)
+        {
+            child->bitmap = slotBit(entry.hash, shift + BITS);
+        }
+        child->entries.push_back(entry);
+        entry = Entry{0, nullptr, 0, child};
+        node = child.get();
+    }
+}
+
+void StateVersion::Builder::erase(std::string_view key)
+{
+    int64_t value;
+    if (!version)
+    {
+        throw std::logic_error("State version builder was already published");
+    }
+    if (!version->find(key, value))
+    {
+        return; // чтобы не копировать путь к отсутствующему ключу
+    }
+    const size_t hash = std::hash<std::string_view>()(key);
+    version->root = editable(version->root);
+    Node* node = version->root.get();
+    for (unsigned shift = 0;; shift += BITS)
+    {
+        if (shift >= HASH_BITS)
+        {
+            for (auto it = node->entries.begin(); it != node->entries.end(); ++it)
+            {
+                if (*it->key == key)
+                {
+                    node->entries.erase(it);
+                    --version->count;
+                    return;
+                }
+            }
+            return;
+        }
+        const uint32_t bit = slotBit(hash, shift);
+        Entry& entry = node->entries[slotPosition(node->bitmap, bit)];
+        if (entry.child)
+        {
+            entry.child = editable(entry.child);
+            node = entry.child.get();
+            continue;
+        }
+        node->entries.erase(node->entries.begin() + slotPosition(node->bitmap, bit));
+        node->bitmap &= ~bit;
+        --version->count;
+        return;
+    }
+}
+
+std::shared_ptr<const StateVersion> StateVersion::Builder::publish(uint64_t height)
+{
+    if (!version)
+    {
+        throw std::logic_error("State version builder was already published");
+    }
+    version->height = height;
+    return std::move(version); // после публикации узлы этого построителя больше не меняются
+}
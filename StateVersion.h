@@ -0,0 +1,98 @@
+#ifndef STATEVERSION_H
+#define STATEVERSION_H
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "StateStore.h"
+
+// Неизменяемая версия состояния после блока height - для читателей вне chainMutex.
+// Внутри persistent HAMT: 32-арные узлы по 5 бит хэша ключа с битовой картой занятых слотов.
+// Следующая версия строится Builder'ом: копируются только узлы на путях к изменённым ключам,
+// остальное дерево общее с предыдущей версией. Блок стоит O(затронутых ключей * log32 N),
+// читатель берёт версию за O(1) и может держать её сколько угодно.
+//
+// Имена ключей не копируются: запись указывает на строку в KeyInterner, который
+// версия держит через shared_ptr (строки там не переезжают).
+class StateVersion
+{
+    struct Node;
+
+public:
+    StateVersion(); // пустое состояние на высоте 0
+    StateVersion(const StateVersion&) = delete;
+    StateVersion& operator=(const StateVersion&) = delete;
+
+    uint64_t getHeight() const { return height; }
+    bool find(std::string_view key, int64_t& value) const;
+    int64_t get(std::string_view key) const; // 0 для отсутствующего ключа
+    size_t size() const { return count; }
+    std::map<std::string, int64_t> toMap() const;
+
+    template <typename Visitor>
+    void forEach(Visitor&& visitor) const
+    {
+        visit(*root, visitor);
+    }
+
+    // Одноразовый построитель следующей версии. Узлы, созданные этим построителем,
+    // правятся на месте (их ещё никто не видит), чужие - копируются.
+    class Builder
+    {
+    public:
+        // base == nullptr - с пустого состояния. Ключи base и новые ключи - из одного keys.
+        Builder(std::shared_ptr<const StateVersion> base, std::shared_ptr<const KeyInterner> keys);
+        void set(const std::string& key, int64_t value); // key - строка из keys (KeyInterner::name)
+        void erase(std::string_view key); // опустевшие узлы не схлопываются - поиск это не ломает
+        std::shared_ptr<const StateVersion> publish(uint64_t height);
+
+    private:
+        std::shared_ptr<StateVersion> version;
+        uint64_t edit;
+
+        std::shared_ptr<Node> editable(const std::shared_ptr<Node>& node) const;
+    };
+
+private:
+    struct Entry
+    {
+        size_t hash = 0;
+        const std::string* key = nullptr; // nullptr - в слоте поддерево
+        int64_t value = 0;
+        std::shared_ptr<Node> child;
+    };
+    struct Node
+    {
+        uint32_t bitmap = 0; // узел коллизий (хэш исчерпан) не использует карту, записи лежат подряд
+        uint64_t edit = 0;   // какой Builder создал узел
+        std::vector<Entry> entries;
+    };
+    static constexpr unsigned BITS = 5;
+    static constexpr unsigned HASH_BITS = 8 * sizeof(size_t);
+
+    std::shared_ptr<Node> root;
+    std::shared_ptr<const KeyInterner> keys;
+    uint64_t height = 0;
+    size_t count = 0;
+
+    template <typename Visitor>
+    static void visit(const Node& node, Visitor& visitor)
+    {
+        for (const Entry& entry : node.entries)
+        {
+            if (entry.child)
+            {
+                visit(*entry.child, visitor);
+            }
+            else
+            {
+                visitor(*entry.key, entry.value);
+            }
+        }
+    }
+};
+
+#endif // STATEVERSION_H
@@ -0,0 +1,21 @@
+#ifndef STATEVIEW_H
+#define STATEVIEW_H
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// То, что видит исполняемая транзакция: чтение/запись ключей и точки отката.
+// Реализации: StateOverlay (последовательное исполнение поверх StateStore) и
+// спекулятивное состояние транзакции в BlockExecutor.
+class StateView
+{
+public:
+    virtual ~StateView() = default;
+    virtual int64_t get(std::string_view key) const = 0; // 0 для отсутствующего ключа
+    virtual void set(std::string_view key, int64_t value) = 0;
+    virtual void add(std::string_view key, int64_t delta) { set(key, get(key) + delta); }
+    virtual size_t checkpoint() const = 0;
+    virtual void revertTo(size_t checkpoint) = 0;
+};
+
+#endif // STATEVIEW_H
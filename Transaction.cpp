@@ -1,12 +1,90 @@
 #include "Transaction.h"
 #include <stdexcept>
 #include <sstream>
+#include <cstring>
+#include <openssl/sha.h>
+
+namespace {
+
+void appendLE64(std::vector<uint8_t>& out, uint64_t value)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void appendBytes(std::vector<uint8_t>& out, const uint8_t* data, size_t length)
+{
+    uint32_t size = static_cast<uint32_t>(length);
+    for (int i = 0; i < 4; ++i)
+    {
+        out.push_back(static_cast<uint8_t>(size >> (8 * i)));
+    }
+    out.insert(out.end(), data, data + length);
+}
+
+void appendString(std::vector<uint8_t>& out, const std::string& value)
+{
+    appendBytes(out, reinterpret_cast<const uint8_t*>(value.data()), value.size());
+}
+
+// Последовательное чтение кодировки с проверкой границ
+class Reader
+{
+public:
+    Reader(const uint8_t* data, size_t length) : data(data), length(length), position(0) {}
+
+    uint64_t readLE(int bytes)
+    {
+        require(bytes);
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i)
+        {
+            value |= uint64_t(data[position + i]) << (8 * i);
+        }
+        position += bytes;
+        return value;
+    }
+
+    std::vector<uint8_t> readBytes()
+    {
+        size_t size = static_cast<size_t>(readLE(4));
+        require(size);
+        std::vector<uint8_t> bytes(data + position, data + position + size);
+        position += size;
+        return bytes;
+    }
+
+    std::string readString()
+    {
+        std::vector<uint8_t> bytes = readBytes();
+        return std::string(bytes.begin(), bytes.end());
+    }
+
+    bool atEnd() const { return position == length; }
+
+private:
+    void require(size_t bytes) const
+    {
+        if (bytes > length - position)
+        {
+            throw std::runtime_error("Truncated transaction encoding");
+        }
+    }
+
+    const uint8_t* data;
+    size_t length;
+    size_t position;
+};
+
+}
 
 Transaction::Transaction(std::string sender, std::string recipient, double amount,
                          std::string signature, std::vector<uint8_t> contractCode,
-                         int64_t gasLimit, std::string gltchCode)
+                         int64_t gasLimit, std::string gltchCode, int64_t gasPrice)
     : sender(sender), recipient(recipient), amount(amount), signature(signature),
-    contractCode(contractCode), gasLimit(gasLimit), gltchCode(gltchCode)
+    contractCode(contractCode), gasLimit(gasLimit), gltchCode(gltchCode), gasPrice(gasPrice)
 {
     if (sender.empty())
         throw std::invalid_argument("Sender cannot be empty!");
@@ -18,6 +96,18 @@ Transaction::Transaction(std::string sender, std::string recipient, double amoun
         throw std::invalid_argument("Signature cannot be empty!");
     if (gasLimit <= 0)
         throw std::invalid_argument("Gas limit must be positive!");
+    if (gasPrice <= 0)
+        throw std::invalid_argument("Gas price must be positive!");
+    if (gasPrice - DEFAULT_GAS_PRICE > INT64_MAX / gasLimit)
+        throw std::invalid_argument("Gas price times gas limit overflows!");
+    encode();
+}
+
+Transaction::Transaction(std::string sender, std::string recipient, double amount,
+                         std::string signature, std::vector<uint8_t> contractCode,
+                         int64_t gasLimit, std::string gltchCode)
+    : Transaction(sender, recipient, amount, signature, contractCode, gasLimit, gltchCode, DEFAULT_GAS_PRICE)
+{
 }
 
 Transaction::Transaction(std::string sender, std::string recipient, double amount,
@@ -28,11 +118,11 @@ Transaction::Transaction(std::string sender, std::string recipient, double amoun
     // Делегируем вызов конструктору с gltchCode, передавая пустую строку
 }
 
-std::string Transaction::getSender() const
+const std::string& Transaction::getSender() const
 {
     return sender;
 }
-std::string Transaction::getRecipient() const
+const std::string& Transaction::getRecipient() const
 {
     return recipient;
 }
@@ -40,11 +130,11 @@ double Transaction::getAmount() const
 {
     return amount;
 }
-std::string Transaction::getSignature() const
+const std::string& Transaction::getSignature() const
 {
     return signature;
 }
-std::vector<uint8_t> Transaction::getContractCode() const
+const std::vector<uint8_t>& Transaction::getContractCode() const
 {
     return contractCode;
 }
@@ -52,16 +142,99 @@ int64_t Transaction::getGasLimit() const
 {
     return gasLimit;
 }
-std::string Transaction::getGltchCode() const
+int64_t Transaction::getGasPrice() const
+{
+    return gasPrice;
+}
+const std::string& Transaction::getGltchCode() const
 {
     return gltchCode;
 }
 
-std::string Transaction::toString() const
+Transaction Transaction::deserialize(const uint8_t* data, size_t length)
+{
+    Reader reader(data, length);
+    std::string sender = reader.readString();
+    std::string recipient = reader.readString();
+    uint64_t amountBits = reader.readLE(8);
+    double amount;
+    std::memcpy(&amount, &amountBits, sizeof(amount));
+    std::string signature = reader.readString();
+    std::vector<uint8_t> contractCode = reader.readBytes();
+    int64_t gasLimit = static_cast<int64_t>(reader.readLE(8));
+    std::string gltchCode = reader.readString();
+    int64_t gasPrice = DEFAULT_GAS_PRICE;
+    if (!reader.atEnd())
+    {
+        gasPrice = static_cast<int64_t>(reader.readLE(8));
+        if (gasPrice == DEFAULT_GAS_PRICE)
+        {
+            throw std::runtime_error("Non-canonical transaction encoding: explicit default gas price");
+        }
+    }
+    if (!reader.atEnd())
+    {
+        throw std::runtime_error("Trailing bytes after transaction encoding");
+    }
+    return Transaction(sender, recipient, amount, signature, contractCode, gasLimit, gltchCode, gasPrice);
+}
+
+const std::string& Transaction::toString() const
+{
+    return description;
+}
+
+const std::vector<uint8_t>& Transaction::serialize() const
+{
+    return encoded;
+}
+
+int64_t Transaction::getPriorityFee() const
+{
+    return (gasPrice - DEFAULT_GAS_PRICE) * gasLimit;
+}
+
+const Hash256& Transaction::getTxid() const
+{
+    return txid;
+}
+
+Hash256 Transaction::getSourceTxid() const
+{
+    if (gltchCode.empty() || contractCode.empty())
+    {
+        return txid;
+    }
+    return Transaction(sender, recipient, amount, signature, {}, gasLimit, gltchCode, gasPrice).getTxid();
+}
+
+void Transaction::encode()
 {
+    encoded.reserve(5 * 4 + 3 * 8 + sender.size() + recipient.size() + signature.size()
+                    + contractCode.size() + gltchCode.size());
+    appendString(encoded, sender);
+    appendString(encoded, recipient);
+    uint64_t amountBits;
+    std::memcpy(&amountBits, &amount, sizeof(amountBits));
+    appendLE64(encoded, amountBits);
+    appendString(encoded, signature);
+    appendBytes(encoded, contractCode.data(), contractCode.size());
+    appendLE64(encoded, static_cast<uint64_t>(gasLimit));
+    appendString(encoded, gltchCode);
+    if (gasPrice != DEFAULT_GAS_PRICE)
+    {
+        appendLE64(encoded, static_cast<uint64_t>(gasPrice));
+    }
+
+    HashBytes first;
+    HashBytes second;
+    SHA256(encoded.data(), encoded.size(), first.data());
+    SHA256(first.data(), first.size(), second.data());
+    txid = Hash256(second);
+
     std::stringstream ss;
     ss << "Transaction(sender=" << sender << ", recipient=" << recipient
        << ", amount=" << amount << ", signature=" << signature
-       << ", gasLimit=" << gasLimit << ")";
-    return ss.str();
+       << ", gasLimit=" << gasLimit << ", gasPrice=" << gasPrice << ")";
+    description = ss.str();
 }
@@ -4,10 +4,17 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include "Hash256.h"
 
 class Transaction
 {
 public:
+    static constexpr int64_t DEFAULT_GAS_PRICE = 1;
+
+    // Конструктор с платой за единицу газа: по ней мемпул выбирает транзакции в блок
+    Transaction(std::string sender, std::string recipient, double amount,
+                std::string signature, std::vector<uint8_t> contractCode,
+                int64_t gasLimit, std::string gltchCode, int64_t gasPrice);
     // Конструктор с gltchCode
     Transaction(std::string sender, std::string recipient, double amount,
                 std::string signature, std::vector<uint8_t> contractCode,
@@ -16,14 +23,28 @@ public:
     Transaction(std::string sender, std::string recipient, double amount,
                 std::string signature, std::vector<uint8_t> contractCode,
                 int64_t gasLimit);
-    std::string getSender() const;
-    std::string getRecipient() const;
+    const std::string& getSender() const;
+    const std::string& getRecipient() const;
     double getAmount() const;
-    std::string getSignature() const;
-    std::vector<uint8_t> getContractCode() const;
+    const std::string& getSignature() const;
+    const std::vector<uint8_t>& getContractCode() const;
     int64_t getGasLimit() const;
-    std::string getGltchCode() const;
-    std::string toString() const;
+    int64_t getGasPrice() const;
+    // (gasPrice - DEFAULT_GAS_PRICE) * gasLimit: плата за место в очереди мемпула,
+    // списывается с отправителя при исполнении. С ценой по умолчанию - 0
+    int64_t getPriorityFee() const;
+    const std::string& getGltchCode() const;
+    const std::string& toString() const;
+    // Каноническое бинарное представление (поля с префиксом длины, little-endian).
+    // gasPrice дописывается в конец, только если он не DEFAULT_GAS_PRICE - старые txid не меняются.
+    // Транзакция неизменяема, поэтому кодировка, txid и toString считаются один раз в конструкторе.
+    const std::vector<uint8_t>& serialize() const;
+    const Hash256& getTxid() const; // SHA256d(serialize()), лист Merkle-дерева
+    // txid без байт-кода, скомпилированного из gltchCode: не меняется, когда сборка блока
+    // перекомпилирует GLTCH. Для транзакций без GLTCH совпадает с getTxid()
+    Hash256 getSourceTxid() const;
+    // Обратное к serialize(); бросает std::runtime_error на повреждённых данных
+    static Transaction deserialize(const uint8_t* data, size_t length);
 
 private:
     std::string sender;
@@ -33,6 +54,13 @@ private:
     std::vector<uint8_t> contractCode;
     int64_t gasLimit;
     std::string gltchCode;
+    int64_t gasPrice;
+
+    std::vector<uint8_t> encoded;
+    Hash256 txid;
+    std::string description;
+
+    void encode();
 };
 
 #endif
@@ -0,0 +1,80 @@
+#include "TransactionQueue.h"
+
+TransactionQueue::TransactionQueue()
+{
+    Node* stub = new Node();
+    head.store(stub, std::memory_order_relaxed);
+    tail = stub;
+}
+
+TransactionQueue::~TransactionQueue()
+{
+    // Производителей уже нет: недобранные транзакции просто освобождаются
+    Node* node = tail;
+    while (node)
+    {
+        Node* next = node->next.load(std::memory_order_relaxed);
+        delete node;
+        node = next;
+    }
+}
+
+bool TransactionQueue::push(Transaction tx)
+{
+    Node* node = new Node();
+    node->tx.emplace(std::move(tx));
+    return link(node, node, 1);
+}
+
+bool TransactionQueue::push(std::vector<Transaction> transactions)
+{
+    if (transactions.empty())
+    {
+        return false;
+    }
+    // Цепочка собирается без синхронизации - её ещё никто не видит
+    Node* first = new Node();
+    first->tx.emplace(std::move(transactions[0]));
+    Node* last = first;
+    for (size_t i = 1; i < transactions.size(); ++i)
+    {
+        Node* node = new Node();
+        node->tx.emplace(std::move(transactions[i]));
+        last->next.store(node, std::memory_order_relaxed);
+        last = node;
+    }
+    return link(first, last, transactions.size());
+}
+
+bool TransactionQueue::link(Node* first, Node* last, size_t count)
+{
+    const bool wasEmpty = pending.fetch_add(count, std::memory_order_acq_rel) == 0;
+    Node* previous = head.exchange(last, std::memory_order_acq_rel);
+    // До этой записи потребитель видит очередь оборванной на previous и подождёт
+    previous->next.store(first, std::memory_order_release);
+    return wasEmpty;
+}
+
+size_t TransactionQueue::drain(std::vector<Transaction>& out, size_t max)
+{
+    size_t taken = 0;
+    while (taken < max)
+    {
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next)
+        {
+            break;
+        }
+        out.push_back(std::move(*next->tx));
+        next->tx.reset(); // next становится фиктивным узлом
+        delete tail;
+        tail = next;
+        ++taken;
+    }
+    return taken;
+}
+
+bool TransactionQueue::release(size_t count)
+{
+    return pending.fetch_sub(count, std::memory_order_acq_rel) == count;
+}
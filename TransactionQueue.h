@@ -0,0 +1,46 @@
+#ifndef TRANSACTIONQUEUE_H
+#define TRANSACTIONQUEUE_H
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <vector>
+#include "Transaction.h"
+
+// Очередь входящих транзакций: много производителей, один потребитель, без блокировок
+// (узловая MPSC-очередь Вьюкова). Вставка - один atomic exchange головы, производители
+// не ждут ни друг друга, ни потребителя; пачка вставляется целиком тем же одним exchange.
+//
+// pending считает вставленные, но ещё не забранные транзакции. По нему производитель
+// узнаёт, что очередь была пуста (и надо будить потребителя), а потребитель - что можно
+// засыпать: drain может вернуть меньше pending, если производитель ещё не дописал ссылку.
+class TransactionQueue
+{
+public:
+    TransactionQueue();
+    ~TransactionQueue();
+    TransactionQueue(const TransactionQueue&) = delete;
+    TransactionQueue& operator=(const TransactionQueue&) = delete;
+
+    // true - очередь была пуста: вызывающий будит потребителя
+    bool push(Transaction tx);
+    bool push(std::vector<Transaction> transactions); // пустая пачка - false
+
+    // Дальше - только из потока-потребителя
+    size_t drain(std::vector<Transaction>& out, size_t max); // дописывает в out до max транзакций
+    bool release(size_t count); // после drain: count забрано; true - очередь опустела
+
+private:
+    struct Node
+    {
+        std::atomic<Node*> next{nullptr};
+        std::optional<Transaction> tx; // у фиктивного узла (tail) пусто
+    };
+
+    alignas(64) std::atomic<Node*> head; // последний вставленный узел, общий для производителей
+    alignas(64) std::atomic<size_t> pending{0};
+    alignas(64) Node* tail;              // фиктивный узел перед первой транзакцией, только у потребителя
+
+    bool link(Node* first, Node* last, size_t count);
+};
+
+#endif // TRANSACTIONQUEUE_H
@@ -0,0 +1,286 @@
+#include "UndoStore.h"
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include "Crc32.h"
+#include "Logger.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint32_t UNDO_MAGIC = 0x0D0B10C5;
+constexpr size_t RECORD_HEADER_SIZE = 20; // magic | height | длина | CRC32
+
+void appendLE(std::vector<uint8_t>& out, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i)
+    {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+uint64_t readLE(const uint8_t* in, int bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i)
+    {
+        value |= uint64_t(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+std::runtime_error systemError(const std::string& what)
+{
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+void writeAll(int fd, const uint8_t* data, size_t length, uint64_t offset)
+{
+    while (length > 0)
+    {
+        ssize_t written = ::pwrite(fd, data, length, static_cast<off_t>(offset));
+        if (written < 0)
+        {
+            if (errno == EINTR) continue;
+            throw systemError("Undo store write failed");
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+}
+
+bool readAll(int fd, uint8_t* data, size_t length, uint64_t offset)
+{
+    while (length > 0)
+    {
+        ssize_t got = ::pread(fd, data, length, static_cast<off_t>(offset));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        data += got;
+        length -= static_cast<size_t>(got);
+        offset += static_cast<uint64_t>(got);
+    }
+    return true;
+}
+
+}
+
+UndoStore::UndoStore(const std::string& directory) : path(directory + "/undo.dat")
+{
+    std::filesystem::create_directories(directory);
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        throw systemError("Failed to open undo store " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        throw systemError("Failed to stat undo store " + path);
+    }
+    const uint64_t size = static_cast<uint64_t>(st.st_size);
+    uint8_t header[RECORD_HEADER_SIZE];
+    while (endOffset + RECORD_HEADER_SIZE <= size && readAll(fd, header, sizeof(header), endOffset)
+           && readLE(header, 4) == UNDO_MAGIC)
+    {
+        const uint64_t height = readLE(header + 4, 8);
+        const uint64_t length = readLE(header + 12, 4);
+        if (size - endOffset - RECORD_HEADER_SIZE < length || (!offsets.empty() && height != firstHeight + offsets.size()))
+        {
+            break;
+        }
+        if (offsets.empty())
+        {
+            firstHeight = height;
+        }
+        offsets.push_back(endOffset);
+        endOffset += RECORD_HEADER_SIZE + length;
+    }
+    if (endOffset < size)
+    {
+        Logger::getInstance().log("Undo store: truncating torn tail of " + path + " at offset " + std::to_string(endOffset));
+        if (::ftruncate(fd, static_cast<off_t>(endOffset)) != 0)
+        {
+            throw systemError("Failed to truncate undo store");
+        }
+    }
+}
+
+UndoStore::~UndoStore()
+{
+    if (fd >= 0)
+    {
+        ::fdatasync(fd);
+        ::close(fd);
+    }
+}
+
+void UndoStore::put(uint64_t height, const BlockUndo& undo)
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    if (!offsets.empty() && (height < firstHeight || height > firstHeight + offsets.size()))
+    {
+        truncateLocked(firstHeight); // высоты не стыкуются: старые логи не нужны
+    }
+    else
+    {
+        truncateLocked(height); // лог этого блока пишется заново (переигровка при старте)
+    }
+
+    std::vector<uint8_t> record(RECORD_HEADER_SIZE);
+    appendLE(record, undo.entries.size(), 4);
+    for (const BlockUndo::Entry& entry : undo.entries)
+    {
+        appendLE(record, entry.key.size(), 4);
+        record.insert(record.end(), entry.key.begin(), entry.key.end());
+        record.push_back(entry.existed ? 1 : 0);
+        appendLE(record, static_cast<uint64_t>(entry.previous), 8);
+    }
+    const uint64_t length = record.size() - RECORD_HEADER_SIZE;
+    std::vector<uint8_t> header;
+    appendLE(header, UNDO_MAGIC, 4);
+    appendLE(header, height, 8);
+    appendLE(header, length, 4);
+    appendLE(header, crc32(record.data() + RECORD_HEADER_SIZE, length), 4);
+    std::memcpy(record.data(), header.data(), RECORD_HEADER_SIZE);
+
+    writeAll(fd, record.data(), record.size(), endOffset);
+    if (offsets.empty())
+    {
+        firstHeight = height;
+    }
+    offsets.push_back(endOffset);
+    endOffset += record.size();
+    if (offsets.size() > 2 * KEPT_BLOCKS)
+    {
+        compact();
+    }
+}
+
+bool UndoStore::read(uint64_t height, BlockUndo& undo) const
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    if (height < firstHeight || height >= firstHeight + offsets.size())
+    {
+        return false;
+    }
+    const uint64_t offset = offsets[height - firstHeight];
+    const uint64_t next = height + 1 < firstHeight + offsets.size() ? offsets[height - firstHeight + 1] : endOffset;
+    std::vector<uint8_t> record(next - offset);
+    if (!readAll(fd, record.data(), record.size(), offset) || readLE(record.data(), 4) != UNDO_MAGIC
+        || readLE(record.data() + 4, 8) != height
+        || readLE(record.data() + 12, 4) != record.size() - RECORD_HEADER_SIZE
+        || readLE(record.data() + 16, 4) != crc32(record.data() + RECORD_HEADER_SIZE, record.size() - RECORD_HEADER_SIZE))
+    {
+        return false;
+    }
+    const uint8_t* data = record.data() + RECORD_HEADER_SIZE;
+    const uint8_t* end = record.data() + record.size();
+    if (end - data < 4)
+    {
+        return false;
+    }
+    const uint64_t count = readLE(data, 4);
+    data += 4;
+    undo.entries.clear();
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        if (end - data < 4)
+        {
+            return false;
+        }
+        const uint64_t keyLength = readLE(data, 4);
+        data += 4;
+        if (static_cast<uint64_t>(end - data) < keyLength + 9)
+        {
+            return false;
+        }
+        BlockUndo::Entry entry;
+        entry.key.assign(reinterpret_cast<const char*>(data), keyLength);
+        data += keyLength;
+        entry.existed = *data++ != 0;
+        entry.previous = static_cast<int64_t>(readLE(data, 8));
+        data += 8;
+        undo.entries.push_back(std::move(entry));
+    }
+    return data == end;
+}
+
+void UndoStore::truncate(uint64_t height)
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    truncateLocked(height);
+}
+
+void UndoStore::truncateLocked(uint64_t height)
+{
+    if (offsets.empty() || height >= firstHeight + offsets.size())
+    {
+        return;
+    }
+    const uint64_t keep = height > firstHeight ? height - firstHeight : 0;
+    endOffset = keep < offsets.size() ? offsets[keep] : endOffset;
+    offsets.resize(keep);
+    if (::ftruncate(fd, static_cast<off_t>(endOffset)) != 0)
+    {
+        throw systemError("Failed to truncate undo store");
+    }
+}
+
+void UndoStore::sync()
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    if (::fdatasync(fd) != 0)
+    {
+        throw systemError("Failed to sync undo store");
+    }
+}
+
+void UndoStore::compact()
+{
+    // Остаются последние KEPT_BLOCKS логов; копируются байты записей как есть
+    const size_t drop = offsets.size() - KEPT_BLOCKS;
+    const uint64_t from = offsets[drop];
+    std::vector<uint8_t> tail(endOffset - from);
+    if (!readAll(fd, tail.data(), tail.size(), from))
+    {
+        throw systemError("Failed to read undo store for compaction");
+    }
+    const std::string tmpPath = path + ".tmp";
+    int tmpFd = ::open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (tmpFd < 0)
+    {
+        throw systemError("Failed to create " + tmpPath);
+    }
+    try
+    {
+        writeAll(tmpFd, tail.data(), tail.size(), 0);
+        if (::fsync(tmpFd) != 0)
+        {
+            throw systemError("Failed to sync " + tmpPath);
+        }
+    }
+    catch (...)
+    {
+        ::close(tmpFd);
+        std::filesystem::remove(tmpPath);
+        throw;
+    }
+    std::filesystem::rename(tmpPath, path);
+    ::close(fd);
+    fd = tmpFd;
+    for (size_t i = 0; i < drop; ++i)
+    {
+        offsets.pop_front();
+    }
+    for (uint64_t& offset : offsets)
+    {
+        offset -= from;
+    }
+    firstHeight += drop;
+    endOffset -= from;
+}
@@ -0,0 +1,55 @@
+#ifndef UNDOSTORE_H
+#define UNDOSTORE_H
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Undo-лог блока: значения затронутых блоком ключей до его исполнения
+struct BlockUndo
+{
+    struct Entry
+    {
+        std::string key;
+        bool existed;     // false - ключ создан блоком, при откате удаляется
+        int64_t previous;
+    };
+    std::vector<Entry> entries;
+};
+
+// Undo-логи последних блоков в <directory>/undo.dat рядом с сегментами BlockStore, только дозапись.
+// Запись (little-endian): magic | height u64 | длина payload u32 | CRC32 payload | payload,
+// payload = число записей u32 | (длина ключа u32 | ключ | existed u8 | previous i64)...
+//
+// Высоты записей идут подряд. Хранятся логи не глубже KEPT_BLOCKS от вершины: когда записей
+// вдвое больше, хвост переписывается в новый файл (временный файл + rename).
+// При открытии читаются только заголовки записей, оборванный хвост обрезается.
+class UndoStore
+{
+public:
+    static constexpr uint64_t KEPT_BLOCKS = 1000; // максимальная глубина отката
+
+    explicit UndoStore(const std::string& directory);
+    ~UndoStore();
+    UndoStore(const UndoStore&) = delete;
+    UndoStore& operator=(const UndoStore&) = delete;
+
+    void put(uint64_t height, const BlockUndo& undo); // логи блоков >= height заменяются
+    bool read(uint64_t height, BlockUndo& undo) const; // false - лога нет или он повреждён
+    void truncate(uint64_t height); // отбрасывает логи блоков >= height
+    void sync();
+
+private:
+    std::string path;
+    mutable std::mutex storeMutex;
+    int fd = -1;
+    uint64_t firstHeight = 0;
+    std::deque<uint64_t> offsets; // смещение записи блока firstHeight + i
+    uint64_t endOffset = 0;
+
+    void truncateLocked(uint64_t height);
+    void compact();
+};
+
+#endif // UNDOSTORE_H
@@ -43,10 +43,10 @@ const char* MyException::what() const noexcept
 
 
 Virtual_Machine::Virtual_Machine(const std::vector<uint8_t>& bytecode,
-    std::map<std::string, int64_t>& storage,
+    StateView& storage,
                                  Context context,std::vector<size_t> callStack,int64_t gasLimit)
     : bytecode(bytecode), storage(storage), context(context),callStack(callStack) ,gasLimit(gasLimit),
-    gasUsed(0), programCounter(0), storageCopy(storage)
+    gasUsed(0), programCounter(0), storageCheckpoint(storage.checkpoint())
 {
     if (bytecode.size() == 0) {
         throw MyException("Empty bytecode");
@@ -73,6 +73,7 @@ bool  Virtual_Machine::execute()
     }
     catch (const MyException& e)
     {
+        revert(); // записи неудачного контракта не должны пережить выполнение
         return false;
     }
 }
@@ -83,7 +84,7 @@ void Virtual_Machine::revert()
     stack_memory.clear();
     log.clear();
     callStack.clear();
-    storage = storageCopy;
+    storage.revertTo(storageCheckpoint);
     gasUsed=0;
     programCounter=0;
 }//Зачем: Откатывает изменения при ошибке.
@@ -373,14 +374,7 @@ void Virtual_Machine::executeOpcode(uint8_t opcodeValue)
             {
                 throw MyException("Invalid type for SLOAD: expected string key");
             }
-            auto it = storage.find(key.str);
-            if (it == storage.end())
-            {
-                pushValue(Value(0));
-            } else
-            {
-                pushValue(Value(it->second));
-            }
+            pushValue(Value(storage.get(key.str))); // отсутствующий ключ читается как 0
         }
         break;
 
@@ -401,7 +395,7 @@ void Virtual_Machine::executeOpcode(uint8_t opcodeValue)
             {
                 throw MyException("Invalid type for SSTORE: expected number value");
             }
-            storage[key.str] = value.num;
+            storage.set(key.str, value.num);
         }
         break;
 
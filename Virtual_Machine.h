@@ -2,9 +2,9 @@
 #define VIRTUAL_MACHINE_H
 #include <vector>
 #include <string>
-#include <map>
 #include <cstdint>
 #include <stdexcept>
+#include "StateView.h"
 
 
 class MyException: public std::exception{
@@ -76,7 +76,7 @@ private:
     // Роль: Поддерживает типы данных для PUSH, SLOAD, SENDER (строки для адресов/ключей, числа для балансов).
     // isString указывает, активно ли поле str или num.
     std::vector< Value>stack_memory;//Стек для временных вычислений (например, для PUSH, ADD, SLOAD)
-    std::map<std::string, int64_t>&storage;//Зачем: Ссылка на globalState блокчейна, хранит постоянные данные контрактов (например, "balance[Alice]": 100).
+    StateView&storage;//Зачем: Состояние блокчейна, видимое транзакции (слой поверх globalState), хранит постоянные данные контрактов (например, "balance[Alice]": 100).
     //Роль: Используется для SLOAD (чтение) и SSTORE (запись).
     std::vector<size_t> callStack;
     std::vector<std::string>log;//Зачем: Хранит события от EMIT (например, "Transfer:Alice:Bob:100").
@@ -84,7 +84,7 @@ private:
     int64_t gasLimit;//Зачем: Максимальный газ для транзакции, берётся из Transaction::gasLimit.
     size_t programCounter;//Зачем: Указывает на текущий байт в bytecode (индекс)
     std::vector<uint8_t> bytecode;//Зачем: Ссылка на байт-код контракта из Transaction::contractCode
-    std::map<std::string, int64_t> storageCopy;//Зачем: Копия storage для отката при ошибке.
+    size_t storageCheckpoint;//Зачем: Метка журнала storage на старте, до неё откатывает revert() - без копии состояния.
 public:
     std::vector<std::string>& getLog();
     struct Context//Зачем: Хранит контекст транзакции.
@@ -98,7 +98,7 @@ public:
     template<typename T>
     T read_bytes_as_type();
     Virtual_Machine(const std::vector<uint8_t>& bytecode,
-                                     std::map<std::string, int64_t>& storage,
+                                     StateView& storage,
                     Context context,std::vector<size_t> callStack,int64_t gasLimit);
     bool execute();
     //Зачем: Выполняет байт-код контракта.
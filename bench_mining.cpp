@@ -0,0 +1,193 @@
+#include "RegularBlock.h"
+#include "MiningKernel.h"
+#include "MiningPool.h"
+#include "Transaction.h"
+#include "Logger.h"
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <iostream>
+#include <string>
+#include <vector>
+#if defined(BLOCKCHAIN_X86_KERNELS)
+#include <x86intrin.h>
+#endif
+
+// Бенчмарк майнинга: calculateHash и перебор nonce на MiningPool по матрице
+// ядро x число транзакций в блоке x число потоков. Logger дублирует всё в stdout,
+// поэтому отчёт пишется отдельным JSON-файлом.
+// Использование: bench_mining [nonces на замер] [повторов calculateHash] [файл отчёта]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+uint64_t readCycles()
+{
+#if defined(BLOCKCHAIN_X86_KERNELS)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+std::vector<Transaction> makeTransactions(size_t count)
+{
+    std::vector<Transaction> transactions;
+    transactions.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::vector<uint8_t> bytecode = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x64, 0x00};
+        transactions.emplace_back("Alice", "Bob", 1.0 + i, "sig" + std::to_string(i), bytecode, 1000, "");
+    }
+    return transactions;
+}
+
+Hash256 benchPrevHash()
+{
+    HashBytes bytes;
+    bytes.fill(0xab);
+    return Hash256(bytes);
+}
+
+std::vector<size_t> threadCounts()
+{
+    std::vector<size_t> counts;
+    const size_t poolThreads = MiningPool::getInstance().getThreadCount();
+    for (size_t threads = 1; threads < poolThreads; threads *= 2)
+    {
+        counts.push_back(threads);
+    }
+    counts.push_back(poolThreads);
+    return counts;
+}
+
+nlohmann::ordered_json benchCalculateHash(const RegularBlock& block, size_t repeats)
+{
+    auto start = Clock::now();
+    uint64_t startCycles = readCycles();
+    uint8_t checksum = 0; // не даёт компилятору выбросить вызовы
+    for (size_t i = 0; i < repeats; ++i)
+    {
+        checksum ^= block.calculateHash().data()[0];
+    }
+    uint64_t cycles = readCycles() - startCycles;
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    nlohmann::ordered_json result;
+    result["hashes"] = repeats;
+    result["seconds"] = seconds;
+    result["hashes_per_sec"] = repeats / (seconds > 0.0 ? seconds : 1e-9);
+    result["cycles_per_hash"] = cycles ? nlohmann::json(double(cycles) / repeats) : nlohmann::json(nullptr);
+    result["checksum"] = checksum;
+    return result;
+}
+
+// Один замер пула: заголовок и midstate строятся внутри, как в mineOnPool,
+// цель недостижима, поэтому перебирается весь диапазон
+nlohmann::ordered_json benchPool(const RegularBlock& block, size_t threads, uint64_t nonces)
+{
+    const HashBytes unreachable{};
+    auto start = Clock::now();
+    uint64_t startCycles = readCycles();
+    const HeaderMidstate midstate(block.getHeader());
+    uint32_t foundNonce = 0;
+    bool found = MiningPool::getInstance().mine(midstate, unreachable, 0, nonces, CancellationToken(),
+                                                foundNonce, threads);
+    uint64_t cycles = readCycles() - startCycles;
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    nlohmann::ordered_json result;
+    result["threads"] = threads;
+    result["hashes"] = nonces;
+    result["seconds"] = seconds;
+    result["hashes_per_sec"] = nonces / (seconds > 0.0 ? seconds : 1e-9);
+    // rdtsc считает такты одного ядра за всё время, поэтому умножаем на число потоков
+    result["cycles_per_hash"] = cycles ? nlohmann::json(double(cycles) * threads / nonces) : nlohmann::json(nullptr);
+    if (found)
+    {
+        result["error"] = "unreachable target was met";
+    }
+    return result;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        const uint64_t nonces = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : (uint64_t(1) << 22);
+        const size_t hashRepeats = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000;
+        const std::string reportPath = argc > 3 ? argv[3] : "bench_mining.json";
+        if (nonces == 0 || nonces > (uint64_t(1) << 32) || hashRepeats == 0)
+        {
+            std::cerr << "Usage: bench_mining [nonces 1..2^32] [calculateHash repeats > 0] [report.json]" << std::endl;
+            return 1;
+        }
+        Logger::getInstance("bench_mining.log").log("=== Mining benchmark ===");
+
+        MiningKernel& kernel = MiningKernel::getInstance();
+        const MiningKernel::Type defaultType = kernel.getType();
+        const std::vector<size_t> txCounts = {1, 16, 256};
+
+        nlohmann::ordered_json report;
+        report["pool_threads"] = MiningPool::getInstance().getThreadCount();
+        report["default_kernel"] = MiningKernel::typeName(defaultType);
+        report["nonces_per_run"] = nonces;
+        report["calculate_hash_repeats"] = hashRepeats;
+        report["results"] = nlohmann::json::array();
+
+        for (MiningKernel::Type type : MiningKernel::supportedTypes())
+        {
+            kernel.setType(type);
+            {
+                // Прогрев: первый замер ядра иначе включает холодные кэши и частоту CPU
+                RegularBlock warmup(0, 1700000000, makeTransactions(1), benchPrevHash(), 0);
+                benchPool(warmup, MiningPool::getInstance().getThreadCount(), MiningPool::CHUNK * 16);
+            }
+            for (size_t txCount : txCounts)
+            {
+                RegularBlock block(1, 1700000000, makeTransactions(txCount), benchPrevHash(), 0);
+
+                nlohmann::ordered_json entry;
+                entry["kernel"] = MiningKernel::typeName(type);
+                entry["transactions"] = txCount;
+                entry["calculate_hash"] = benchCalculateHash(block, hashRepeats);
+                entry["parallel_mining"] = nlohmann::json::array();
+
+                double singleThreadRate = 0.0;
+                for (size_t threads : threadCounts())
+                {
+                    nlohmann::ordered_json run = benchPool(block, threads, nonces);
+                    double rate = run["hashes_per_sec"];
+                    if (threads == 1)
+                    {
+                        singleThreadRate = rate;
+                    }
+                    // Эффективность масштабирования: скорость / (потоки * скорость одного потока)
+                    run["scaling_efficiency"] = singleThreadRate > 0.0 ? rate / (threads * singleThreadRate) : 0.0;
+                    entry["parallel_mining"].push_back(run);
+                }
+                report["results"].push_back(entry);
+            }
+        }
+        kernel.setType(defaultType);
+
+        std::ofstream out(reportPath);
+        if (!out.is_open())
+        {
+            throw std::runtime_error("Failed to open report file: " + reportPath);
+        }
+        out << report.dump(2) << std::endl;
+        Logger::getInstance().log("Benchmark report written to " + reportPath);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
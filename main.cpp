@@ -44,11 +44,12 @@ int main() {
             std::cout << "Chain is invalid" << std::endl;
         }
 
-        auto state = bc.getGlobalState();
-        std::cout << "Alice balance: " << state.at("Alice") / 100.0 << std::endl;
-        std::cout << "Bob balance: " << state.at("Bob") / 100.0 << std::endl;
-        if (state.count("Alice")) {
-            std::cout << "Contract balance (Alice): " << state.at("Alice") << std::endl;
+        auto state = bc.getStateVersion(); // без копии состояния и без chainMutex
+        std::cout << "Alice balance: " << state->get("Alice") / 100.0 << std::endl;
+        std::cout << "Bob balance: " << state->get("Bob") / 100.0 << std::endl;
+        int64_t contractBalance = 0;
+        if (state->find("Alice", contractBalance)) {
+            std::cout << "Contract balance (Alice): " << contractBalance << std::endl;
         }
 std::this_thread::sleep_for(std::chrono::seconds(5));
         // Вызов тестов из Blockchain